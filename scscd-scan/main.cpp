@@ -0,0 +1,541 @@
+// scscd-scan: runs the plugin parser over a directory of plugins, outside the game, and reports
+// how long it took. Used to profile startup scanning against a real Data folder (or a copy of
+// one) without launching Fallout 4. With --materials it instead benchmarks the material reader
+// against the old .dds scraper over a folder of BGSM/BGEM files, such as an extracted Materials
+// folder. With --extract it reads files out of a Data folder's general archives the way material
+// validation does, and lists the textures of any material among them. With --verify-esl it checks
+// the ESL compaction table built from a plugin against a copy of it that xEdit compacted.
+//
+//   scscd-scan [--threads N] [--reader mapped|full|stream|async] [--depth N] [--catalog] [--repeat N]
+//              [--verbose]
+//              <Data folder or plugin files...>
+//   scscd-scan --materials [--repeat N] <material folders or files...>
+//   scscd-scan --extract <Data folder> <paths relative to Data...>
+//   scscd-scan --verify-esl <original plugin> <compacted plugin>
+
+#include "async_io.h"
+#include "ba2_archive.h"
+#include "esl_compaction.h"
+#include "material_file.h"
+#include "plugin_parser.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace fs = std::filesystem;
+
+enum class Reader { Mapped, Full, Stream, Async };
+
+struct Options {
+    size_t threads{ worker_count() };
+    Reader reader{ Reader::Mapped };
+    size_t depth{ AsyncReader::DEFAULT_DEPTH };
+    bool catalog{ false };
+    bool materials{ false };
+    fs::path extract; // Data folder, with --extract
+    bool verifyEsl{ false };
+    int repeat{ 1 };
+    std::vector<fs::path> inputs;
+};
+
+struct PluginStats {
+    fs::path path;
+    uint64_t bytes{ 0 };
+    uint64_t records{ 0 };
+    uint64_t compressed{ 0 };
+    uint64_t compressedBytes{ 0 };
+    uint64_t inflatedBytes{ 0 };
+    uint64_t edids{ 0 };
+    uint64_t catalogued{ 0 };
+    double ms{ 0 };
+};
+
+static void usage()
+{
+    std::fprintf(stderr,
+        "usage: scscd-scan [options] <Data folder or plugin files...>\n"
+        "  --threads N     plugins scanned in parallel (default: one per hardware thread)\n"
+        "  --reader R      mapped (default), full (mapped, whole-record inflate), stream, or async\n"
+        "                  (all plugins read at once through the batched I/O queue)\n"
+        "  --depth N       reads the async reader keeps in flight (default: %zu)\n"
+        "  --catalog       also capture the armor/addon/omod/race catalog\n"
+        "  --repeat N      run the whole scan N times and report each pass\n"
+        "  --materials     benchmark the material reader against the .dds scraper instead; inputs\n"
+        "                  are BGSM/BGEM files or folders searched recursively\n"
+        "  --extract DATA  read the given paths from DATA's loose files and general archives (in\n"
+        "                  name order, since no load order is known) and show where each came from\n"
+        "  --verify-esl    inputs are a plugin and a copy of it compacted by xEdit; check that the\n"
+        "                  compaction table maps every compacted record back to its original\n"
+        "  --verbose       show parser debug logging\n", AsyncReader::DEFAULT_DEPTH);
+}
+
+static bool is_plugin(const fs::path& p)
+{
+    std::string ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return ext == ".esm" || ext == ".esp" || ext == ".esl";
+}
+
+static std::vector<fs::path> collect_plugins(const std::vector<fs::path>& inputs)
+{
+    std::vector<fs::path> plugins;
+    for (const auto& in : inputs) {
+        std::error_code ec;
+        if (fs::is_directory(in, ec)) {
+            for (const auto& entry : fs::directory_iterator(in, ec)) {
+                if (entry.is_regular_file(ec) && is_plugin(entry.path()))
+                    plugins.push_back(entry.path());
+            }
+        }
+        else if (fs::is_regular_file(in, ec)) {
+            plugins.push_back(in);
+        }
+        else {
+            logger::warn(std::format("{}: no such file or directory", in.string()));
+        }
+    }
+    std::sort(plugins.begin(), plugins.end());
+    return plugins;
+}
+
+static uint64_t peak_rss_bytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return pmc.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage ru {};
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<uint64_t>(ru.ru_maxrss);
+#else
+    return static_cast<uint64_t>(ru.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+static std::string lowercase_slashed(std::string_view s)
+{
+    std::string out(s);
+    std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) { return c == '\\' ? '/' : (char)std::tolower(c); });
+    return out;
+}
+
+static std::vector<fs::path> collect_materials(const std::vector<fs::path>& inputs)
+{
+    auto is_material = [](const fs::path& p) {
+        const std::string ext = lowercase_slashed(p.extension().string());
+        return ext == ".bgsm" || ext == ".bgem";
+    };
+    std::vector<fs::path> materials;
+    for (const auto& in : inputs) {
+        std::error_code ec;
+        if (fs::is_directory(in, ec)) {
+            for (const auto& entry : fs::recursive_directory_iterator(in, ec)) {
+                if (entry.is_regular_file(ec) && is_material(entry.path()))
+                    materials.push_back(entry.path());
+            }
+        }
+        else if (fs::is_regular_file(in, ec)) {
+            materials.push_back(in);
+        }
+        else {
+            logger::warn(std::format("{}: no such file or directory", in.string()));
+        }
+    }
+    std::sort(materials.begin(), materials.end());
+    return materials;
+}
+
+// Reads every material into memory first, so that only the two parsers are timed, then runs both
+// over all of them and reports how long each took and where they disagree.
+static int run_materials(const Options& opt)
+{
+    const std::vector<fs::path> paths = collect_materials(opt.inputs);
+    if (paths.empty()) {
+        std::fprintf(stderr, "no materials found\n");
+        return 1;
+    }
+    std::vector<std::vector<uint8_t>> files;
+    files.reserve(paths.size());
+    uint64_t bytes = 0;
+    for (const auto& path : paths) {
+        std::ifstream f(path, std::ios::binary);
+        files.emplace_back(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+        bytes += files.back().size();
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto ms = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    for (int pass = 0; pass < opt.repeat; pass++) {
+        uint64_t read = 0, slots = 0, unknown = 0;
+        std::vector<std::string_view> views;
+        auto start = clock::now();
+        for (const auto& file : files) {
+            views.clear();
+            const size_t used = read_material_textures(file, views);
+            if (used) read += used;
+            else unknown++;
+            slots += views.size();
+        }
+        const double readerMs = ms(clock::now() - start);
+
+        uint64_t scraped = 0;
+        start = clock::now();
+        for (const auto& file : files) scraped += scrape_dds_paths(file).size();
+        const double scraperMs = ms(clock::now() - start);
+
+        std::printf("pass %d: %zu materials, %.1f KB\n", pass + 1, files.size(), bytes / 1024.0);
+        std::printf("        reader:  %9.2f ms, %llu texture slots, %.1f KB read up to the last slot, %llu not understood\n",
+            readerMs, (unsigned long long)slots, read / 1024.0, (unsigned long long)unknown);
+        std::printf("        scraper: %9.2f ms, %llu .dds paths\n", scraperMs, (unsigned long long)scraped);
+    }
+
+    // Where the two disagree, file by file: .dds paths only the scraper saw, and slots the scraper
+    // can't see because they don't name a .dds.
+    uint64_t onlyScraped = 0, notDds = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        std::vector<std::string_view> views;
+        if (!read_material_textures(files[i], views)) {
+            std::printf("%s: not a material of a known version, or cut short\n", paths[i].string().c_str());
+            continue;
+        }
+        std::vector<std::string> slots;
+        for (std::string_view v : views) {
+            slots.push_back(lowercase_slashed(v));
+            if (slots.back().find(".dds") == std::string::npos) {
+                notDds++;
+                std::printf("%s: slot %.*s doesn't name a .dds\n", paths[i].string().c_str(), (int)v.size(), v.data());
+            }
+        }
+        for (const auto& path : scrape_dds_paths(files[i])) {
+            if (std::find(slots.begin(), slots.end(), lowercase_slashed(path)) == slots.end()) {
+                onlyScraped++;
+                std::printf("%s: scraper found %s, which is in no slot\n", paths[i].string().c_str(), path.c_str());
+            }
+        }
+    }
+    std::printf("%llu slots the scraper misses, %llu scraped paths the reader doesn't have\n",
+        (unsigned long long)notDds, (unsigned long long)onlyScraped);
+    std::printf("peak RSS: %.1f MB\n", peak_rss_bytes() / 1048576.0);
+    return 0;
+}
+
+// Reads each path the way material validation does and reports where it came from; for materials,
+// also its texture slots.
+static int run_extract(const Options& opt)
+{
+    std::vector<fs::path> ba2s;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(opt.extract, ec)) {
+        if (entry.is_regular_file(ec) && lowercase_slashed(entry.path().extension().string()) == ".ba2")
+            ba2s.push_back(entry.path());
+    }
+    auto start = std::chrono::steady_clock::now();
+    GeneralArchives archives;
+    archives.open(opt.extract, ba2_load_order(std::move(ba2s), {}));
+    std::printf("opened %zu general archives, %zu files, in %.2f ms\n", archives.archives(), archives.files(),
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    int missing = 0;
+    std::vector<uint8_t> bytes;
+    for (const auto& input : opt.inputs) {
+        const std::string path = input.string();
+        if (!archives.read(path, bytes)) {
+            std::printf("%s: not found\n", path.c_str());
+            missing++;
+            continue;
+        }
+        std::printf("%s: %zu bytes from %s\n", path.c_str(), bytes.size(), archives.source(path).c_str());
+        std::vector<std::string_view> slots;
+        if (read_material_textures(bytes, slots)) {
+            for (std::string_view slot : slots)
+                std::printf("    texture %.*s\n", (int)slot.size(), slot.data());
+        }
+    }
+    return missing ? 1 : 0;
+}
+
+// Signature and EDID (empty if none) of every record a plugin adds itself, by object ID, from
+// every group including the nested ones.
+static bool read_new_records(const fs::path& path, std::map<uint32_t, std::pair<uint32_t, std::string>>& out)
+{
+    std::vector<std::string> masters;
+    MappedFile mapped(path);
+    if (!mapped.ok() || !read_plugin_masters(path, masters)) return false;
+    const std::span<const uint8_t> bytes = mapped.bytes();
+    RecordHeader tes4;
+    std::memcpy(&tes4, bytes.data(), sizeof(tes4));
+    if (tes4.dataSize > bytes.size() - HEADER_SIZE) return false;
+    std::vector<uint8_t> scratch;
+    size_t off = HEADER_SIZE + tes4.dataSize;
+    while (bytes.size() - off >= HEADER_SIZE) {
+        const uint8_t* p = bytes.data() + off;
+        if (std::memcmp(p, "GRUP", 4) == 0) {
+            off += HEADER_SIZE;
+            continue;
+        }
+        RecordHeader rh;
+        std::memcpy(&rh, p, sizeof(rh));
+        if (rh.dataSize > bytes.size() - off - HEADER_SIZE) break;
+        std::span<const uint8_t> payload = bytes.subspan(off + HEADER_SIZE, rh.dataSize);
+        off += HEADER_SIZE + rh.dataSize;
+        if ((rh.formID >> 24) < masters.size()) continue;
+        if (rh.flags & RECORD_FLAG_COMPRESSED) {
+            if (payload.size() < 4 || !inflate_zlib(payload.data() + 4, payload.size() - 4, rd_le32(payload.data()), scratch)) continue;
+            payload = scratch;
+        }
+        out[rh.formID & 0x00FFFFFFu] = { FOURCC(rh.sig[0], rh.sig[1], rh.sig[2], rh.sig[3]), std::string(parse_edid_from_record_bytes(payload)) };
+    }
+    return true;
+}
+
+// Builds the compaction table from the original plugin, the way the game plugin does for a CSV's
+// light form IDs, and checks it against a copy that xEdit actually compacted: each record of the
+// copy, put through the table, must land on a record of the original with the same signature and
+// EDID.
+static int run_verify_esl(const Options& opt)
+{
+    if (opt.inputs.size() != 2) {
+        usage();
+        return 2;
+    }
+    std::map<uint32_t, std::pair<uint32_t, std::string>> original, compacted;
+    std::vector<uint32_t> ids;
+    if (!read_new_object_ids(opt.inputs[0], ids) || !read_new_records(opt.inputs[0], original) || !read_new_records(opt.inputs[1], compacted)) {
+        std::fprintf(stderr, "could not read the plugins\n");
+        return 1;
+    }
+    const EslCompaction table(std::move(ids));
+    if (table.overflow()) {
+        std::printf("%s adds too many records to compact\n", opt.inputs[0].filename().string().c_str());
+        return 1;
+    }
+
+    auto sig = [](uint32_t s) { return std::string(reinterpret_cast<const char*>(&s), 4); };
+    size_t matched = 0, unnamed = 0, wrong = 0;
+    for (const auto& [id, record] : compacted) {
+        const uint32_t from = table.original(id);
+        auto it = from ? original.find(from) : original.end();
+        if (it == original.end()) {
+            std::printf("%06x %s %s: no original record\n", id, sig(record.first).c_str(), record.second.c_str());
+            wrong++;
+        }
+        else if (it->second != record) {
+            std::printf("%06x %s %s: table says %06x, which is %s %s\n", id, sig(record.first).c_str(), record.second.c_str(),
+                from, sig(it->second.first).c_str(), it->second.second.c_str());
+            wrong++;
+        }
+        else if (record.second.empty()) {
+            unnamed++; // same signature, but nothing else to compare
+        }
+        else {
+            matched++;
+        }
+    }
+    std::printf("%zu records compacted (%zu renumbered): %zu match by signature and EDID, %zu by signature only (no EDID), %zu wrong\n",
+        compacted.size(), table.moved(), matched, unnamed, wrong);
+    return wrong ? 1 : 0;
+}
+
+// Counts one record into `s` and runs it through the parser the options ask for.
+static bool scan_record(PluginStats& s, RecordCatalog& catalog, std::vector<uint8_t>& scratch, const Options& opt,
+    const RecordHeader& rh, std::span<const uint8_t> payload)
+{
+    auto count = [&s](uint32_t, std::string_view, uint32_t) {
+        s.edids++;
+        return true;
+    };
+    s.records++;
+    if (rh.flags & RECORD_FLAG_COMPRESSED) {
+        s.compressed++;
+        s.compressedBytes += payload.size();
+        if (payload.size() >= 4) s.inflatedBytes += rd_le32(payload.data());
+    }
+    if (opt.catalog)
+        return visit_edid_and_catalog(rh, payload, scratch, count, catalog);
+    if (opt.reader == Reader::Full)
+        return visit_edid<InflateMode::Full>(rh, payload, scratch, count);
+    return visit_edid(rh, payload, scratch, count);
+}
+
+static PluginStats scan_plugin(const fs::path& path, const Options& opt)
+{
+    PluginStats s;
+    s.path = path;
+    std::error_code ec;
+    s.bytes = fs::file_size(path, ec);
+
+    auto start = std::chrono::steady_clock::now();
+    RecordCatalog catalog;
+    std::vector<uint8_t> scratch;
+    auto visit = [&](const RecordHeader& rh, std::span<const uint8_t> payload) {
+        return scan_record(s, catalog, scratch, opt, rh, payload);
+    };
+
+    if (opt.reader == Reader::Stream) {
+        walk_stream(path, visit);
+    }
+    else {
+        MappedFile mapped(path);
+        if (mapped.ok()) walk_records(mapped.bytes(), visit);
+        else logger::warn(std::format("could not map {}", path.string()));
+    }
+    s.catalogued = catalog.records();
+    s.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return s;
+}
+
+static void run_pass(const std::vector<fs::path>& plugins, const Options& opt, int pass)
+{
+    std::vector<PluginStats> stats(plugins.size());
+    auto start = std::chrono::steady_clock::now();
+    if (opt.reader == Reader::Async) {
+        // Every plugin is in flight at once, so a plugin's time is from the start of the pass
+        // until its last group was parsed.
+        std::vector<RecordCatalog> catalogs(plugins.size());
+        std::vector<std::vector<uint8_t>> scratch(plugins.size());
+        for (size_t i = 0; i < plugins.size(); i++) {
+            std::error_code ec;
+            stats[i].path = plugins[i];
+            stats[i].bytes = fs::file_size(plugins[i], ec);
+        }
+        read_plugin_groups(plugins, ALL_RECORD_TYPE_BITS, [&](size_t i, std::span<const uint8_t> group) {
+            auto visit = [&](const RecordHeader& rh, std::span<const uint8_t> payload) {
+                return scan_record(stats[i], catalogs[i], scratch[i], opt, rh, payload);
+            };
+            walk_records(group, visit);
+            stats[i].catalogued = catalogs[i].records();
+            stats[i].ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            return true;
+        }, opt.depth, opt.threads);
+    }
+    else {
+        parallel_for(plugins.size(), [&](size_t i) { stats[i] = scan_plugin(plugins[i], opt); }, opt.threads);
+    }
+    const double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    PluginStats total;
+    for (const auto& s : stats) {
+        if (pass == 0) {
+            std::printf("%-48s %10.1f KB %8llu records %7llu compressed %8llu edids %6llu catalogued %9.2f ms\n",
+                s.path.filename().string().c_str(), s.bytes / 1024.0,
+                (unsigned long long)s.records, (unsigned long long)s.compressed,
+                (unsigned long long)s.edids, (unsigned long long)s.catalogued, s.ms);
+        }
+        total.bytes += s.bytes;
+        total.records += s.records;
+        total.compressed += s.compressed;
+        total.compressedBytes += s.compressedBytes;
+        total.inflatedBytes += s.inflatedBytes;
+        total.edids += s.edids;
+        total.catalogued += s.catalogued;
+        total.ms += s.ms;
+    }
+
+    const double secs = wallMs / 1000.0;
+    std::printf("pass %d: %zu plugins, %.1f MB, %llu records (%llu compressed, %.1f MB -> %.1f MB), %llu edids, %llu catalogued\n",
+        pass + 1, plugins.size(), total.bytes / 1048576.0,
+        (unsigned long long)total.records, (unsigned long long)total.compressed,
+        total.compressedBytes / 1048576.0, total.inflatedBytes / 1048576.0,
+        (unsigned long long)total.edids, (unsigned long long)total.catalogued);
+    std::printf("        %.2f ms wall, %.2f ms summed over plugins, %.0f records/s, %.1f MB/s on %zu threads\n",
+        wallMs, total.ms, secs > 0 ? total.records / secs : 0.0, secs > 0 ? total.bytes / 1048576.0 / secs : 0.0,
+        std::min(std::max<size_t>(opt.threads, 1), std::max<size_t>(plugins.size(), 1)));
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "%s needs a value\n", arg.c_str());
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--threads") {
+            opt.threads = std::strtoul(value(), nullptr, 10);
+        }
+        else if (arg == "--reader") {
+            const std::string r = value();
+            if (r == "mapped") opt.reader = Reader::Mapped;
+            else if (r == "full") opt.reader = Reader::Full;
+            else if (r == "stream") opt.reader = Reader::Stream;
+            else if (r == "async") opt.reader = Reader::Async;
+            else { usage(); return 2; }
+        }
+        else if (arg == "--depth") {
+            opt.depth = std::max<size_t>(1, std::strtoul(value(), nullptr, 10));
+        }
+        else if (arg == "--catalog") {
+            opt.catalog = true;
+        }
+        else if (arg == "--extract") {
+            opt.extract = value();
+        }
+        else if (arg == "--verify-esl") {
+            opt.verifyEsl = true;
+        }
+        else if (arg == "--materials") {
+            opt.materials = true;
+        }
+        else if (arg == "--repeat") {
+            opt.repeat = std::max(1, std::atoi(value()));
+        }
+        else if (arg == "--verbose") {
+            logger::set_level(spdlog::level::debug);
+        }
+        else if (arg == "--help" || arg == "-h") {
+            usage();
+            return 0;
+        }
+        else if (arg.starts_with("--")) {
+            usage();
+            return 2;
+        }
+        else {
+            opt.inputs.emplace_back(arg);
+        }
+    }
+    if (opt.inputs.empty()) {
+        usage();
+        return 2;
+    }
+
+    if (opt.materials)
+        return run_materials(opt);
+    if (!opt.extract.empty())
+        return run_extract(opt);
+    if (opt.verifyEsl)
+        return run_verify_esl(opt);
+
+    const std::vector<fs::path> plugins = collect_plugins(opt.inputs);
+    if (plugins.empty()) {
+        std::fprintf(stderr, "no plugins found\n");
+        return 1;
+    }
+
+    for (int pass = 0; pass < opt.repeat; pass++)
+        run_pass(plugins, opt, pass);
+    std::printf("peak RSS: %.1f MB\n", peak_rss_bytes() / 1048576.0);
+    return 0;
+}
@@ -35,6 +35,8 @@
  *    at random yielded way too many invalid results. Even within a particular ESP,
  *    there are often too many options for a random choice to work. This field does
  *    not seem to be available at all, so we're dead.
+ *    [MNAM is now read straight from the plugin files instead; see
+ *    OmodIndex::CompatibleWith().]
  *    I thought to simply add ALL mods to the instance and then let RemoveInvalidMods()
  *    do the work, but I don't see any way to iterate over the mods once attached.
  *    Without that, we would always have every attachment on every armor - seems bad.
@@ -1,5 +1,6 @@
 #include "scscd.h"
 #include "matswap_validity_report.h"
+#include <chrono>
 #include <random>
 
 ArmorIndex::CacheHit ArmorIndex::cachedIndexLookup(bool nsfw, RE::TESRace* race, uint32_t sex, uint32_t occupation)
@@ -140,13 +141,13 @@ void ArmorIndex::put(Tuple &t) {
 	for (uint32_t formID : t.armors) {
 		RE::TESObjectARMO* armo = static_cast<RE::TESObjectARMO*>(RE::TESForm::GetFormByID(formID));
 		if (!armo) continue;
-		for (RE::TESRace* race : t.possibleRaces()) {
+		for (uint32_t race : t.possibleRaces()) {
 			for (uint32_t sex : t.possibleSexes()) {
 				for (uint32_t occupation : t.possibleOccupations()) {
 					ArmorIndexKey key(race, sex, occupation, t.isNSFW);
 					for (uint8_t slot : t.occupiedSlots()) {
 						logger::trace(std::format("ArmorIndex::put r={:#010x} s={:x} o={:#010x} nsfw={} slot={} id={}",
-							race->GetFormID(), sex, occupation, t.isNSFW, slot, t.id));
+							race, sex, occupation, t.isNSFW, slot, t.id));
 						size_t idx = this->tupleStorage.size();
 						this->tupleStorage.push_back(t);
 						logger::trace(std::format("ArmorIndex::put ... stored as tuple={}", this->tupleStorage[idx].inspect()));
@@ -402,7 +403,16 @@ static inline RE::BGSMaterialSwap* AsMSWP(RE::TESForm* f) {
 	return f ? f->As<RE::BGSMaterialSwap>() : nullptr;
 }
 
+// Each swap is validated once; later omods that use it get the remembered verdict. Its problems
+// are only logged the first time.
 static bool validateMSWP(RE::BGSMaterialSwap *swap) {
+	auto& cache = detail::validationCache;
+	cache.swapStats.lookups++;
+	if (auto it = cache.swaps.find(swap->GetFormID()); it != cache.swaps.end()) {
+		cache.swapStats.hits++;
+		logger::trace(std::format("  mswp {:#010x} already validated: {}", swap->GetFormID(), it->second ? "ok" : "failed"));
+		return it->second;
+	}
 	bool valid = true;
 	logger::trace(std::format("  validating mswp: {:#010x}", swap->GetFormID()));
 	SwapPreflightReport report = PreflightValidateBGSMTextures(swap);
@@ -422,6 +432,7 @@ static bool validateMSWP(RE::BGSMaterialSwap *swap) {
 			valid = false;
 		}
 	}
+	cache.swaps.emplace(swap->GetFormID(), valid);
 	return valid;
 }
 
@@ -454,81 +465,174 @@ TryGetPropertySpan(const RE::BGSMod::Container* cont)
 	return {}; // none found
 }
 
-bool ArmorIndex::registerOmods(std::vector<RE::TESObjectARMO*>& armors, std::vector<RE::BGSMod::Attachment::Mod*>& omods, bool nsfw) {
-	logger::trace("> ArmorIndex::registerOmods");
-
-	/*
-	 validate omods: if we can reach into the BSMaterialSwap we should be able to use RE::BSResourceNiBinaryStream
-	 to try and open the material/texture files (even if it's in an archive) to check whether the materials are actually
-	 available. If we do this we won't have any purple outfits at runtime if someone's got an ESP but missing the
-	 textures.
-	*/
-	std::vector<RE::BGSMod::Attachment::Mod*> validOmods;
-	for (RE::BGSMod::Attachment::Mod* mod : omods) {
-		bool valid = true;
-
-		// legacy - matswap specified directly on omod; uncommon in FO4 but should still be supported
-		if (mod->swapForm) {
-			if (!validateMSWP(mod->swapForm)) {
-				logger::error(std::format("skipped: omod {:#010x} failed validation (1)", mod->GetFormID()));
-				valid = false;
-			}
-		}
+// Calls visit(swap, how) for each material swap an omod applies, where `how` tells the log which
+// way the omod named it: 1 directly, 2 as a form property, 3 as a (form, value) pair property.
+template <class F>
+static void forEachSwap(RE::BGSMod::Attachment::Mod* mod, F&& visit) {
+	// legacy - matswap specified directly on omod; uncommon in FO4 but should still be supported
+	if (mod->swapForm) {
+		visit(mod->swapForm, 1);
+	}
 
-		// FO4 'modern' - matswap specified as omod property. mod->GetData() isn't working in our revision,
-		// so we'll try an alternative way to gain access.
-		const auto props = TryGetPropertySpan(mod);
-		for (const auto& p : props) {
-			switch (p.type) {
-				case RE::BGSMod::Property::TYPE::kForm: {
-					if (auto* f = p.data.form) {
-						if (auto* mswp = f->As<RE::BGSMaterialSwap>()) {
-							if (!validateMSWP(mswp)) {
-								logger::error(std::format("skipped: omod {:#010x}: mswp {:#010x} failed validation (2)", mod->GetFormID(), mswp->GetFormID()));
-								valid = false;
-							}
-						}
+	// FO4 'modern' - matswap specified as omod property. mod->GetData() isn't working in our revision,
+	// so we'll try an alternative way to gain access.
+	const auto props = TryGetPropertySpan(mod);
+	for (const auto& p : props) {
+		switch (p.type) {
+			case RE::BGSMod::Property::TYPE::kForm: {
+				if (auto* f = p.data.form) {
+					if (auto* mswp = f->As<RE::BGSMaterialSwap>()) {
+						visit(mswp, 2);
 					}
-					break;
 				}
-				case RE::BGSMod::Property::TYPE::kPair: {
-					// Some mods encode (form,value) in a pair. Resolve the formID.
-					const auto formID = p.data.fv.formID;
-					if (auto* f = RE::TESForm::GetFormByID(formID)) {
-						if (auto* mswp = f->As<RE::BGSMaterialSwap>()) {
-							if (!validateMSWP(mswp)) {
-								logger::error(std::format("skipped: omod {:#010x}: mswp {:#010x} failed validation (3)", mod->GetFormID(), mswp->GetFormID()));
-								valid = false;
-							}
-						}
+				break;
+			}
+			case RE::BGSMod::Property::TYPE::kPair: {
+				// Some mods encode (form,value) in a pair. Resolve the formID.
+				const auto formID = p.data.fv.formID;
+				if (auto* f = RE::TESForm::GetFormByID(formID)) {
+					if (auto* mswp = f->As<RE::BGSMaterialSwap>()) {
+						visit(mswp, 3);
 					}
-					break;
 				}
-				default:
-					// kEnum/kInt/kFloat/kBool/kString don't carry forms; ignore for MSWP collection.
-					break;
+				break;
 			}
+			default:
+				// kEnum/kInt/kFloat/kBool/kString don't carry forms; ignore for MSWP collection.
+				break;
+		}
+	}
+}
+
+/*
+ validate omods: if we can reach into the BSMaterialSwap we should be able to use RE::BSResourceNiBinaryStream
+ to try and open the material/texture files (even if it's in an archive) to check whether the materials are actually
+ available. If we do this we won't have any purple outfits at runtime if someone's got an ESP but missing the
+ textures.
+*/
+static bool validateOmod(RE::BGSMod::Attachment::Mod* mod) {
+	bool valid = true;
+	forEachSwap(mod, [&](RE::BGSMaterialSwap* mswp, int how) {
+		if (validateMSWP(mswp)) return;
+		if (how == 1)
+			logger::error(std::format("skipped: omod {:#010x} failed validation (1)", mod->GetFormID()));
+		else
+			logger::error(std::format("skipped: omod {:#010x}: mswp {:#010x} failed validation ({})", mod->GetFormID(), mswp->GetFormID(), how));
+		valid = false;
+	});
+	return valid;
+}
+
+// The materials an omod's swaps name, as the verdict cache keys them: sorted, each once. Only
+// looks at the forms, so it costs no I/O.
+static std::vector<std::string> omodMaterials(RE::BGSMod::Attachment::Mod* mod) {
+	std::vector<std::string> materials;
+	forEachSwap(mod, [&](RE::BGSMaterialSwap* mswp, int) {
+		for (const auto& kv : mswp->swapMap) {
+			const char* matPath = kv.second.swapMaterial.c_str();
+			if (matPath && *matPath) materials.push_back(detail::MaterialKey(matPath));
 		}
+	});
+	std::sort(materials.begin(), materials.end());
+	materials.erase(std::unique(materials.begin(), materials.end()), materials.end());
+	return materials;
+}
+
+// Names an omod for the verdict cache by its plugin and object ID, so the key survives load order
+// changes. Empty if its plugin can't be told.
+static std::string omodKey(RE::BGSMod::Attachment::Mod* mod) {
+	const PluginRegistry& registry = PluginRegistry::Instance();
+	const std::optional<FormKey> key = registry.locate(mod->GetFormID());
+	return key ? std::format("{}|{:06x}", registry[key->plugin].filename, key->objectID) : std::string();
+}
 
-		if (valid) validOmods.push_back(mod);
+// Reuses the verdict saved for an omod last launch if nothing it depended on changed: it names the
+// same materials, the texture index is the same, and every material is unchanged. Otherwise
+// validates it. Either way the verdict is recorded for the next launch.
+static bool validateOmodOrReuse(RE::BGSMod::Attachment::Mod* mod, size_t& reused) {
+	const std::string key = omodKey(mod);
+	std::vector<std::string> materials = omodMaterials(mod);
+	detail::OmodVerdictCache& cache = detail::omodVerdicts;
+	const OmodVerdict* saved = key.empty() ? nullptr : cache.savedOmod(key);
+	if (saved && cache.sameIndex() && saved->materials == materials
+			&& std::all_of(materials.begin(), materials.end(), detail::MaterialUnchanged)) {
+		for (const std::string& material : materials) cache.keepMaterial(material);
+		cache.record(key, *saved);
+		reused++;
+		return saved->valid;
 	}
-	logger::trace(std::format("{} of {} omods survived validation", validOmods.size(), omods.size()));
+	const bool valid = validateOmod(mod);
+	if (!key.empty()) cache.record(key, OmodVerdict{ valid, std::move(materials) });
+	return valid;
+}
 
+bool ArmorIndex::registerOmods(std::vector<RE::TESObjectARMO*>& armors, std::vector<RE::BGSMod::Attachment::Mod*>& omods, bool nsfw) {
+	logger::trace("> ArmorIndex::registerOmods");
+	PendingOmods pending{ {}, omods, nsfw };
 	for (RE::TESObjectARMO* armor : armors) {
-		uint32_t armorID = armor->GetFormID();
-		for (RE::BGSMod::Attachment::Mod* omod : validOmods) {
-			uint32_t omodID = omod->GetFormID();
-			std::unordered_set<uint32_t>& index = (nsfw ? nsfwArmorOmods[armorID] : sfwArmorOmods[armorID]);
-			// don't register an omod more than once, else we'll end up weighting that
-			// omod more than the others. (Guessing usually would not be what is intended.)
-			if (!index.contains(omodID)) {
-				index.insert(omodID);
-				omodProximityIndex.add(omodID, omod->GetFormEditorID());
+		pending.armors.push_back(armor->GetFormID());
+	}
+	pendingOmods.push_back(std::move(pending));
+	logger::trace("< ArmorIndex::registerOmods");
+	return true;
+}
+
+void ArmorIndex::validateOmods(bool background, bool engineMaterialReads) {
+	// The engine's resource system is only used from the thread that handles the load messages.
+	if (background && engineMaterialReads)
+		logger::warn("bEngineMaterialReads has no effect while omods are validated in the background");
+	detail::engineMaterialReads = engineMaterialReads && !background;
+	if (background) {
+		omodValidation = std::jthread([this](std::stop_token stop) { runOmodValidation(stop); });
+	}
+	else {
+		runOmodValidation({});
+	}
+}
+
+void ArmorIndex::runOmodValidation(std::stop_token stop) {
+	auto start = std::chrono::steady_clock::now();
+	const std::filesystem::path cachePath = DataPath(OMOD_VERDICT_CACHE_FILE);
+	detail::omodVerdicts.load(cachePath, detail::textureIndex.fingerprint());
+	size_t reused = 0, valid = 0, rejected = 0;
+	std::unordered_map<uint32_t, bool> verdicts; // by omod form ID
+	for (PendingOmods& pending : pendingOmods) {
+		if (stop.stop_requested()) return;
+
+		std::vector<RE::BGSMod::Attachment::Mod*> validOmods;
+		for (RE::BGSMod::Attachment::Mod* mod : pending.omods) {
+			auto [verdict, first] = verdicts.try_emplace(mod->GetFormID(), false);
+			if (first) {
+				verdict->second = validateOmodOrReuse(mod, reused);
+				(verdict->second ? valid : rejected)++;
+			}
+			if (verdict->second) validOmods.push_back(mod);
+		}
+		logger::trace(std::format("{} of {} omods survived validation", validOmods.size(), pending.omods.size()));
+
+		// Only now can sampling see them.
+		std::unique_lock lock(omodsMutex);
+		for (uint32_t armorID : pending.armors) {
+			for (RE::BGSMod::Attachment::Mod* omod : validOmods) {
+				uint32_t omodID = omod->GetFormID();
+				std::unordered_set<uint32_t>& index = (pending.nsfw ? nsfwArmorOmods[armorID] : sfwArmorOmods[armorID]);
+				// don't register an omod more than once, else we'll end up weighting that
+				// omod more than the others. (Guessing usually would not be what is intended.)
+				if (!index.contains(omodID)) {
+					index.insert(omodID);
+					omodProximityIndex.add(omodID, omod->GetFormEditorID());
+				}
 			}
 		}
 	}
-	logger::trace("< ArmorIndex::registerMatswaps");
-	return true;
+	pendingOmods.clear();
+	pendingOmods.shrink_to_fit();
+
+	detail::omodVerdicts.save(cachePath);
+
+	logger::info(std::format("omod validation: {} valid, {} rejected ({} verdicts reused from the last launch), in {} ms", valid, rejected,
+		reused, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()));
+	LogValidationStats();
 }
 
 RE::BGSMod::Attachment::Mod* ArmorIndex::sampleOmod(RE::TESObjectARMO* armor, float proximityBias, RE::BGSMod::Attachment::Mod* other, bool allowNSFW) {
@@ -536,13 +640,18 @@ RE::BGSMod::Attachment::Mod* ArmorIndex::sampleOmod(RE::TESObjectARMO* armor, fl
 	uint32_t armorFormID = armor->GetFormID();
 	uint32_t otherFormID = other ? other->GetFormID() : 0xFFFFFFFF;
 	std::vector<uint32_t> candidates;
-	for (uint32_t candidate : sfwArmorOmods[armorFormID])
-		candidates.push_back(candidate);
-	if (allowNSFW) {
-		for (uint32_t candidate : nsfwArmorOmods[armorFormID])
-			candidates.push_back(candidate);
+	uint32_t sampledID;
+	{
+		// validation may still be promoting omods; only look, don't create entries
+		std::shared_lock lock(omodsMutex);
+		if (auto it = sfwArmorOmods.find(armorFormID); it != sfwArmorOmods.end())
+			candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+		if (allowNSFW) {
+			if (auto it = nsfwArmorOmods.find(armorFormID); it != nsfwArmorOmods.end())
+				candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+		}
+		sampledID = omodProximityIndex.sampleBiased(otherFormID, candidates, proximityBias);
 	}
-	uint32_t sampledID = omodProximityIndex.sampleBiased(otherFormID, candidates, proximityBias);
 	RE::TESForm* form = RE::TESForm::GetFormByID(sampledID);
 	if (form == NULL) {
 		logger::trace("< ArmorIndex::sampleOmod NULL");
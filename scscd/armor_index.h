@@ -4,9 +4,12 @@
 #include "scscd.h"
 #include "tuple.h"
 #include <shared_mutex>
+#include <thread>
 #include <set>
 #include <functional>
 #include "edid_similarity.h"
+#include "edid_table.h"
+#include "plugin_catalog.h"
 #include <filesystem>
 
 // Utility: check if a biped slot (30-61) is set in the mask returned by GetFilledSlots()
@@ -27,6 +30,11 @@ static int bit2slot(int bit) {
 	return bit + 30;
 }
 
+// Editor IDs named by the CSV files, keyed by lowercase plugin name (that is, the name of the
+// CSV file they came from) and then by editor ID. Each editor ID carries a FormTypeBit mask of
+// the types it is allowed to resolve to.
+using EdidRequests = std::unordered_map<std::string, std::unordered_map<std::string, uint32_t, EdidHash, EdidEqual>>;
+
 
 class ArmorIndexKey {
 public:
@@ -42,6 +50,11 @@ public:
 	{
 	}
 
+	ArmorIndexKey(uint32_t race, uint32_t sex, uint32_t occupation, bool nsfw)
+		: race(race), sex(sex), occupation(occupation), isNSFW(nsfw)
+	{
+	}
+
 	bool operator==(const ArmorIndexKey& o) const noexcept {
 		return race == o.race
 			&& sex == o.sex
@@ -64,7 +77,14 @@ namespace std {
 } // namespace std
 
 class ArmorIndex {
-	static std::unordered_map<RE::ENUM_FORM_ID, std::unordered_map<std::string, uint32_t>> FORMS_BY_EDID_BY_TYPE;
+	static EdidTable FORMS_BY_EDID;
+	// Scoped alternative to the above, by plugin name (case-insensitive, like editor IDs).
+	// Only populated by indexRequestedFormsByPluginAndEdid().
+	static std::unordered_map<std::string, EdidTable, EdidHash, EdidEqual> FORMS_BY_EDID_BY_PLUGIN;
+	static bool SCOPED_EDIDS;
+	// Armor, addon, omod and race fields read from the plugin files alongside the EDIDs, merged
+	// in load order with runtime form IDs.
+	static RecordCatalog CATALOG;
 
 	// map of tuple ID -> tuple
 	std::vector<Tuple> tupleStorage;
@@ -84,6 +104,21 @@ class ArmorIndex {
 	std::unordered_map<uint32_t, std::unordered_set<uint32_t>> sfwArmorOmods;
 	std::unordered_map<uint32_t, std::unordered_set<uint32_t>> nsfwArmorOmods;
 	EdidIndex omodProximityIndex;
+	// Guards the two omod maps and omodProximityIndex while validation may still be adding to
+	// them; sampling only takes it shared.
+	mutable std::shared_mutex omodsMutex;
+
+	// Omods as registered, waiting for validateOmods(): one entry per registerOmods() call. None
+	// of them is offered by sampleOmod() until it has passed validation.
+	struct PendingOmods {
+		std::vector<uint32_t> armors;
+		std::vector<RE::BGSMod::Attachment::Mod*> omods;
+		bool nsfw;
+	};
+	std::vector<PendingOmods> pendingOmods;
+	std::jthread omodValidation;
+
+	void runOmodValidation(std::stop_token stop);
 
 	typedef struct {
 		// vector of tuple IDs for any given slot that can be sampled by the
@@ -198,6 +233,70 @@ public:
 		 */
 		float proximityBias{ 2.0 };
 
+		/*
+		 * If true, editor IDs in the CSV files are resolved only against
+		 * the plugin the CSV file is named after, its masters and
+		 * Fallout4.esm, and only plugins that CSV files actually refer to
+		 * are scanned at startup. If false, every active plugin is scanned
+		 * and an editor ID may resolve to a form in any of them. Editor
+		 * IDs a CSV takes from a plugin outside its plugin's masters don't
+		 * resolve when scoped, so it is off unless asked for. Only read at
+		 * startup.
+		 */
+		bool scopedEdidLookup{ false };
+
+		/*
+		 * If true, clothing CSV lines that list no omods are given every
+		 * omod the plugin files say is compatible with each armor (see
+		 * OmodIndex::CompatibleWith). Only read at startup.
+		 */
+		bool discoverOmods{ false };
+
+		/*
+		 * If true, plugins and texture archives start being read on a
+		 * background thread as soon as SCSCD loads, while the game is
+		 * still loading, instead of once game data is ready. Only read
+		 * at startup.
+		 */
+		bool prescanPlugins{ true };
+
+		/*
+		 * If true, the independent parts of startup (EDID index, texture
+		 * index, each CSV directory) run side by side once game data is
+		 * ready, each waiting only on what it reads. If false they run one
+		 * at a time, in the same order. Only read at startup.
+		 */
+		bool parallelStartup{ true };
+
+		/*
+		 * If true, the texture index is built from the hashes stored in
+		 * each BA2's file records; if false, from the file names at the
+		 * end of each archive, which takes more reading. Only read at
+		 * startup.
+		 */
+		bool textureIndexFromRecords{ true };
+
+		/*
+		 * If true, a material that is neither a loose file nor in a general
+		 * BA2 our reader understands is also looked for through the game's
+		 * resource system before its omod is rejected. Only read at startup.
+		 */
+		bool engineMaterialReads{ false };
+
+		/*
+		 * If true, omods are validated on a thread of their own after startup
+		 * and each becomes available to sampling once it passes; until then
+		 * NPCs get only the omods validated so far. If false, startup waits
+		 * for all of them. Only read at startup.
+		 *
+		 * That thread runs while the game does, so it must not call into the
+		 * engine's resource system or change any form. It only reads forms,
+		 * which are fully loaded by then, and our own files, indexes and
+		 * archive reader. engineMaterialReads is ignored there: a material
+		 * that is neither loose nor in a general BA2 counts as missing.
+		 */
+		bool validateOmodsInBackground{ true };
+
 		std::filesystem::path inipath, defaultPath;
 		std::time_t iniModTime{ 0 };
 
@@ -222,32 +321,65 @@ public:
 
 	static void indexAllFormsByTypeAndEdid();
 
-	static uint32_t getFormByTypeAndEdid(RE::ENUM_FORM_ID form_type, const std::string& edid, bool warn = true) {
-		auto maybeFormsByEdid = FORMS_BY_EDID_BY_TYPE.find(form_type);
-		if (maybeFormsByEdid != FORMS_BY_EDID_BY_TYPE.end()) {
-			auto& formsByEdid = maybeFormsByEdid->second;
-			auto maybeFormID = formsByEdid.find(edid);
-			if (maybeFormID != formsByEdid.end()) {
-				return maybeFormID->second;
-			}
-			else {
-				if (warn) logger::warn(std::format("form index for type {:#010x} contains no edid {}", (uint32_t) form_type, edid));
-			}
-		}
-		else {
-			if (warn) logger::warn(std::format("form index does not contain type {:#010x} (given edid {} but could not check)", (uint32_t)form_type, edid));
-		}
-		return 0;
+	/*
+	 * Demand-driven alternative to indexAllFormsByTypeAndEdid(). Only the
+	 * EDIDs in `requests` are looked for, and each is resolved within the
+	 * plugin that requested it, falling back through its masters (and
+	 * Fallout4.esm) until it is found. Afterwards EDID lookups through
+	 * findFormsByEdid() are scoped to the requesting plugin.
+	 */
+	static void indexRequestedFormsByPluginAndEdid(const EdidRequests& requests);
+
+	static bool hasScopedEdids() { return SCOPED_EDIDS; }
+
+	/*
+	 * Armor model data for every active plugin, built by whichever of the
+	 * two index functions above ran. Queries return nullopt for forms that
+	 * aren't in it (e.g. created at runtime); ask the engine instead.
+	 */
+	static const RecordCatalog& catalog() { return CATALOG; }
+
+	/*
+	 * Every indexed form that goes by `edid`, one per form type. In scoped
+	 * mode only forms visible to `plugin` are considered; otherwise `plugin`
+	 * is ignored.
+	 */
+	static EdidTable::Match findFormsByEdid(const std::string& plugin, std::string_view edid);
+
+	/*
+	 * Developer aid: runs the mapped and stream EDID readers over every plugin in
+	 * `dir` and logs the throughput of each. Nothing is indexed.
+	 */
+	static void benchmarkEdidScan(const std::filesystem::path& dir);
+
+	static uint32_t getFormByTypeAndEdid(RE::ENUM_FORM_ID form_type, std::string_view edid, bool warn = true) {
+		uint32_t formID = FORMS_BY_EDID.find(form_type, edid);
+		if (formID == 0 && warn)
+			logger::warn(std::format("form index for type {:#010x} contains no edid {}", (uint32_t)form_type, edid));
+		return formID;
 	}
-	
+
 	/*
 	 * Registers a set of omods to a set of armors. Later, any one armor can be
-	 * used to retrieve a random omod.
+	 * used to retrieve a random omod. The omods are only queued here; they
+	 * can't be sampled until validateOmods() has checked them.
 	 * 
 	 * Returns true on success.
 	 */
 	bool registerOmods(std::vector<RE::TESObjectARMO*>& armors, std::vector<RE::BGSMod::Attachment::Mod*>& omods, bool isNSFW);
 
+	/*
+	 * Validates every omod registered so far (that its material swaps'
+	 * materials and textures exist) and makes each set available to
+	 * sampleOmod() as soon as it has been checked. With `background` this
+	 * returns at once and the work runs on a thread of its own; otherwise it
+	 * returns when all are done. With `engineMaterialReads`, and only when
+	 * not in the background, materials our own reader can't find are also
+	 * looked for through the engine. Call once, after all omods are
+	 * registered.
+	 */
+	void validateOmods(bool background, bool engineMaterialReads);
+
 	/*
 	 * Samples available omods for the given armor, returning one of them.
 	 * You can provide 'other' to indicate a previous matswap selection. If you
@@ -0,0 +1,268 @@
+#include "async_io.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    struct File {
+#ifdef _WIN32
+        HANDLE handle;
+#else
+        int fd;
+#endif
+        uint64_t size;
+    };
+}
+
+#ifdef _WIN32
+
+struct AsyncReader::Impl {
+    // Completion keys. Reads carry READ; QUIT wakes a worker to exit.
+    static constexpr ULONG_PTR READ = 1, QUIT = 2;
+
+    struct Op {
+        OVERLAPPED ov{};
+        HANDLE file;
+        size_t length;
+        std::vector<uint8_t> buf; // allocated when the read is issued
+        Completion done;
+    };
+
+    HANDLE port;
+    std::vector<File> files;
+    std::mutex m;
+    std::condition_variable idle;
+    std::deque<Op*> pending; // waiting for a free queue slot
+    size_t depth;
+    size_t inFlight{ 0 };
+    size_t outstanding{ 0 }; // queued and not yet through their callback
+    std::vector<std::jthread> workers;
+
+    Impl(size_t depth, size_t nworkers) : depth(std::max<size_t>(depth, 1)) {
+        port = ::CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0);
+        for (size_t i = 0; i < std::max<size_t>(nworkers, 1); i++)
+            workers.emplace_back([this] { work(); });
+    }
+
+    ~Impl() {
+        for (size_t i = 0; i < workers.size(); i++)
+            ::PostQueuedCompletionStatus(port, 0, QUIT, nullptr);
+        workers.clear();
+        for (const File& f : files) ::CloseHandle(f.handle);
+        ::CloseHandle(port);
+    }
+
+    void issue(Op* op) {
+        op->buf.resize(op->length);
+        if (!::ReadFile(op->file, op->buf.data(), (DWORD)op->buf.size(), nullptr, &op->ov)
+            && ::GetLastError() != ERROR_IO_PENDING) {
+            // Failed before it was queued, so no packet is coming for it: post one ourselves
+            // with a zero byte count, which the worker treats as a failed read.
+            ::PostQueuedCompletionStatus(port, 0, READ, &op->ov);
+        }
+    }
+
+    void work() {
+        while (true) {
+            DWORD bytes = 0;
+            ULONG_PTR key = 0;
+            OVERLAPPED* ov = nullptr;
+            const BOOL ok = ::GetQueuedCompletionStatus(port, &bytes, &key, &ov, INFINITE);
+            if (key == QUIT) return;
+            if (!ov) continue;
+            Op* op = CONTAINING_RECORD(ov, Op, ov);
+            if (!ok || bytes != op->buf.size()) op->buf.clear();
+
+            Op* next = nullptr;
+            {
+                std::lock_guard lock(m);
+                if (pending.empty()) inFlight--;
+                else { next = pending.front(); pending.pop_front(); }
+            }
+            if (next) issue(next);
+
+            op->done(std::move(op->buf));
+            delete op;
+            std::lock_guard lock(m);
+            if (--outstanding == 0) idle.notify_all();
+        }
+    }
+
+    int open(const std::filesystem::path& path) {
+        HANDLE h = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+        if (h == INVALID_HANDLE_VALUE) return -1;
+        LARGE_INTEGER sz{};
+        if (!::GetFileSizeEx(h, &sz) || !::CreateIoCompletionPort(h, port, READ, 0)) {
+            ::CloseHandle(h);
+            return -1;
+        }
+        std::lock_guard lock(m);
+        files.push_back({ h, (uint64_t)sz.QuadPart });
+        return (int)files.size() - 1;
+    }
+
+    void read(int file, uint64_t offset, size_t length, Completion done) {
+        Op* op = new Op;
+        op->ov.Offset = (DWORD)offset;
+        op->ov.OffsetHigh = (DWORD)(offset >> 32);
+        op->length = length;
+        op->done = std::move(done);
+        {
+            std::lock_guard lock(m);
+            op->file = files[file].handle;
+            outstanding++;
+            if (inFlight >= depth) {
+                pending.push_back(op);
+                return;
+            }
+            inFlight++;
+        }
+        issue(op);
+    }
+};
+
+#else
+
+struct AsyncReader::Impl {
+    struct Op {
+        int fd;
+        uint64_t offset;
+        size_t length;
+        std::vector<uint8_t> buf; // allocated when the read is issued
+        Completion done;
+    };
+
+    std::vector<File> files;
+    std::mutex m;
+    std::condition_variable queued, ready, idle;
+    std::deque<Op> pending;   // waiting for an I/O thread
+    std::deque<Op> completed; // waiting for a worker
+    size_t depth;
+    size_t outstanding{ 0 };
+    bool quit{ false };
+    std::vector<std::jthread> threads;
+
+    Impl(size_t depth, size_t nworkers) : depth(std::max<size_t>(depth, 1)) {
+        for (size_t i = 0; i < this->depth; i++)
+            threads.emplace_back([this] { io(); });
+        for (size_t i = 0; i < std::max<size_t>(nworkers, 1); i++)
+            threads.emplace_back([this] { work(); });
+    }
+
+    ~Impl() {
+        {
+            std::lock_guard lock(m);
+            quit = true;
+        }
+        queued.notify_all();
+        ready.notify_all();
+        threads.clear();
+        for (const File& f : files) ::close(f.fd);
+    }
+
+    static bool pread_all(int fd, uint8_t* p, size_t n, uint64_t offset) {
+        while (n > 0) {
+            const ssize_t got = ::pread(fd, p, n, (off_t)offset);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            p += got;
+            n -= (size_t)got;
+            offset += (uint64_t)got;
+        }
+        return true;
+    }
+
+    void io() {
+        std::unique_lock lock(m);
+        while (true) {
+            // Don't read further ahead than the workers can keep up with.
+            queued.wait(lock, [this] { return quit || (!pending.empty() && completed.size() < depth); });
+            if (quit) return;
+            Op op = std::move(pending.front());
+            pending.pop_front();
+            lock.unlock();
+            op.buf.resize(op.length);
+            if (!pread_all(op.fd, op.buf.data(), op.buf.size(), op.offset)) op.buf.clear();
+            lock.lock();
+            completed.push_back(std::move(op));
+            ready.notify_one();
+        }
+    }
+
+    void work() {
+        std::unique_lock lock(m);
+        while (true) {
+            ready.wait(lock, [this] { return quit || !completed.empty(); });
+            if (quit) return;
+            Op op = std::move(completed.front());
+            completed.pop_front();
+            queued.notify_one();
+            lock.unlock();
+            op.done(std::move(op.buf));
+            lock.lock();
+            if (--outstanding == 0) idle.notify_all();
+        }
+    }
+
+    int open(const std::filesystem::path& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return -1;
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        std::lock_guard lock(m);
+        files.push_back({ fd, (uint64_t)st.st_size });
+        return (int)files.size() - 1;
+    }
+
+    void read(int file, uint64_t offset, size_t length, Completion done) {
+        std::lock_guard lock(m);
+        pending.push_back({ files[file].fd, offset, length, {}, std::move(done) });
+        outstanding++;
+        queued.notify_one();
+    }
+};
+
+#endif
+
+AsyncReader::AsyncReader(size_t depth, size_t workers) : impl_(std::make_unique<Impl>(depth, workers)) {}
+
+AsyncReader::~AsyncReader()
+{
+    wait();
+}
+
+int AsyncReader::open(const std::filesystem::path& path)
+{
+    return impl_->open(path);
+}
+
+uint64_t AsyncReader::size(int file) const
+{
+    std::lock_guard lock(impl_->m);
+    return impl_->files[file].size;
+}
+
+void AsyncReader::read(int file, uint64_t offset, size_t length, Completion done)
+{
+    impl_->read(file, offset, length, std::move(done));
+}
+
+void AsyncReader::wait()
+{
+    std::unique_lock lock(impl_->m);
+    impl_->idle.wait(lock, [this] { return impl_->outstanding == 0; });
+}
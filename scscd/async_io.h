@@ -0,0 +1,50 @@
+#pragma once
+
+#include "thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Keeps many reads, across many files, in flight at once and hands each completed buffer to a
+// worker thread. Plugin and archive scans are a long chain of small dependent reads per file;
+// on a cold cache (or a spinning or network drive) issuing those one file at a time leaves the
+// device idle between requests, whereas keeping a queue of them lets it reorder and overlap.
+//
+// On Windows the reads are overlapped I/O on a completion port, and the workers that dequeue
+// completions run the callbacks. Elsewhere a fixed set of I/O threads, one per queue slot, does
+// blocking preads and passes the buffers on to the workers.
+class AsyncReader {
+public:
+    static constexpr size_t DEFAULT_DEPTH = 32;
+
+    // Called with the bytes that were asked for, or an empty vector if the read failed or came up
+    // short (including reads past the end of the file). Runs on one of the reader's workers, may
+    // queue further reads, and must not throw.
+    using Completion = std::function<void(std::vector<uint8_t> data)>;
+
+    // depth: reads that may be in flight at once. workers: threads that run completions.
+    explicit AsyncReader(size_t depth = DEFAULT_DEPTH, size_t workers = worker_count());
+    ~AsyncReader(); // waits for everything queued
+
+    AsyncReader(const AsyncReader&) = delete;
+    AsyncReader& operator=(const AsyncReader&) = delete;
+
+    // Opens a file, shared with any other reader or writer, for the life of this reader. Returns
+    // an id to pass to read(), or -1 if the file can't be opened.
+    int open(const std::filesystem::path& path);
+    uint64_t size(int file) const;
+
+    // Queues a read of `length` bytes (non-zero) at `offset`. Returns immediately.
+    void read(int file, uint64_t offset, size_t length, Completion done);
+
+    // Blocks until every queued read, including those queued by completions, has been completed
+    // and its callback has returned.
+    void wait();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
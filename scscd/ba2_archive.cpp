@@ -0,0 +1,228 @@
+#include "ba2_archive.h"
+#include "plugin_parser.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iterator>
+#include <tuple>
+
+static inline char NormalizeChar(char c) {
+    if (c == '\\') return '/';
+    return (char)std::tolower((unsigned char)c);
+}
+
+static constexpr std::array<uint32_t, 256> BA2_CRC_TABLE = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        table[i] = c;
+    }
+    return table;
+}();
+
+uint32_t ba2_hash(std::string_view s) {
+    uint32_t h = 0;
+    for (char c : s) {
+        unsigned char b = (unsigned char)NormalizeChar(c);
+        if (b == '/') b = '\\';
+        h = (h >> 8) ^ BA2_CRC_TABLE[(h ^ b) & 0xFF];
+    }
+    return h;
+}
+
+BA2PathHashes ba2_path_hashes(std::string_view path)
+{
+    while (!path.empty() && (path.front() == '/' || path.front() == '\\')) path.remove_prefix(1);
+    const size_t slash = path.find_last_of("/\\");
+    const std::string_view dir = slash == std::string_view::npos ? std::string_view() : path.substr(0, slash);
+    std::string_view file = slash == std::string_view::npos ? path : path.substr(slash + 1);
+    uint32_t ext = 0;
+    if (const size_t dot = file.rfind('.'); dot != std::string_view::npos) {
+        const std::string_view e = file.substr(dot + 1, 4);
+        for (size_t i = 0; i < e.size(); i++) ext |= (uint32_t)(unsigned char)NormalizeChar(e[i]) << (8 * i);
+        file = file.substr(0, dot);
+    }
+    return { ba2_hash(dir), ba2_hash(file), ext };
+}
+
+static bool operator<(const BA2PathHashes& a, const BA2PathHashes& b) {
+    return std::tie(a.dir, a.file, a.ext) < std::tie(b.dir, b.file, b.ext);
+}
+static bool operator==(const BA2PathHashes& a, const BA2PathHashes& b) {
+    return a.dir == b.dir && a.file == b.file && a.ext == b.ext;
+}
+
+std::vector<std::filesystem::path> ba2_load_order(std::vector<std::filesystem::path> archives, std::span<const std::string> plugins)
+{
+    auto lower = [](std::string s) {
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        return s;
+    };
+    std::vector<std::string> prefixes;
+    for (const auto& plugin : plugins) prefixes.push_back(lower(std::filesystem::path(plugin).stem().string()) + " - ");
+    // The plugin an archive belongs to is the longest whose stem, followed by " - ", starts its name.
+    std::vector<std::pair<size_t, std::string>> ranked; // (0 for none, else 1 + load order, lowercase name)
+    ranked.reserve(archives.size());
+    for (const auto& archive : archives) {
+        const std::string name = lower(archive.filename().string());
+        size_t rank = 0, matched = 0;
+        for (size_t i = 0; i < prefixes.size(); i++) {
+            const std::string& stem = prefixes[i];
+            if (stem.size() > matched && name.starts_with(stem)) {
+                rank = i + 1;
+                matched = stem.size();
+            }
+        }
+        ranked.emplace_back(rank, name);
+    }
+    std::vector<size_t> order(archives.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return ranked[a] < ranked[b]; });
+
+    std::vector<std::filesystem::path> sorted;
+    sorted.reserve(archives.size());
+    for (size_t i : order) sorted.push_back(std::move(archives[i]));
+    return sorted;
+}
+
+void GeneralArchives::open(const std::filesystem::path& dataDir, std::span<const std::filesystem::path> archives)
+{
+    data_ = dataDir;
+    for (const auto& path : archives) {
+        MappedFile file(path);
+        if (!file.ok()) {
+            logger::warn(std::format("cannot map BA2 {}", path.string()));
+            continue;
+        }
+        const std::span<const uint8_t> bytes = file.bytes();
+        BA2Header h{};
+        if (bytes.size() < sizeof(h)) continue;
+        std::memcpy(&h, bytes.data(), sizeof(h));
+        if (std::string_view(h.magic, 4) != "BTDX" || std::string_view(h.type, 4) != "GNRL") continue;
+        if (!ba2_known_version(h.version)) {
+            logger::debug(std::format("BA2 {}: version {} not known, skipped", path.string(), h.version));
+            continue;
+        }
+        if ((bytes.size() - sizeof(h)) / BA2_GNRL_RECORD < h.fileCount) {
+            logger::warn(std::format("BA2 {} has a truncated record table", path.string()));
+            continue;
+        }
+        const uint32_t index = (uint32_t)archives_.size();
+        for (uint32_t i = 0; i < h.fileCount; i++) {
+            const uint8_t* r = bytes.data() + sizeof(h) + size_t(i) * BA2_GNRL_RECORD;
+            entries_.push_back({ { rd_le32(r + 8), rd_le32(r), rd_le32(r + 4) }, index, r });
+        }
+        std::error_code ec;
+        const int64_t mtime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+        archives_.push_back({ std::move(file), path.filename().string(), bytes.size(), ec ? 0 : mtime });
+    }
+    // Later archives first among equal keys, so unique() keeps the copy the game would load.
+    std::sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) {
+        return a.key < b.key || (a.key == b.key && a.archive > b.archive);
+    });
+    entries_.erase(std::unique(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) { return a.key == b.key; }), entries_.end());
+    entries_.shrink_to_fit();
+    logger::info(std::format("general archives: {} files in {} archives", entries_.size(), archives_.size()));
+}
+
+const GeneralArchives::Entry* GeneralArchives::find(std::string_view path) const
+{
+    const BA2PathHashes key = ba2_path_hashes(path);
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), key, [](const Entry& e, const BA2PathHashes& k) { return e.key < k; });
+    return it != entries_.end() && it->key == key ? &*it : nullptr;
+}
+
+std::filesystem::path GeneralArchives::loosePath(std::string_view path) const
+{
+    std::string relative(path);
+    std::replace(relative.begin(), relative.end(), '\\', '/');
+    std::filesystem::path exact = data_ / std::filesystem::path(relative).relative_path();
+#ifndef _WIN32
+    // Game paths ignore case. Outside Windows (a headless run over a copy of Data), match each
+    // component of the path against the folder's entries ignoring case, if it isn't there as is.
+    std::error_code ec;
+    if (std::filesystem::exists(exact, ec)) return exact;
+    auto lower = [](std::string s) {
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        return s;
+    };
+    std::filesystem::path resolved = data_;
+    for (const auto& part : std::filesystem::path(relative).relative_path()) {
+        const std::string want = lower(part.string());
+        bool found = false;
+        for (const auto& entry : std::filesystem::directory_iterator(resolved, ec)) {
+            if (lower(entry.path().filename().string()) == want) {
+                resolved = entry.path();
+                found = true;
+                break;
+            }
+        }
+        if (!found) return exact;
+    }
+    return resolved;
+#else
+    return exact;
+#endif
+}
+
+bool GeneralArchives::read(std::string_view path, std::vector<uint8_t>& out) const
+{
+    out.clear();
+    if (path.empty()) return false;
+    std::error_code ec;
+    if (const std::filesystem::path loose = loosePath(path); std::filesystem::is_regular_file(loose, ec)) {
+        std::ifstream f(loose, std::ios::binary);
+        out.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+        return !!f || f.eof();
+    }
+
+    const Entry* e = find(path);
+    if (!e) return false;
+    // offset (u64), packed size (0 if stored), unpacked size, after the hashes and flags
+    uint64_t offset;
+    std::memcpy(&offset, e->record + 16, sizeof(offset));
+    const uint32_t packed = rd_le32(e->record + 24);
+    const uint32_t unpacked = rd_le32(e->record + 28);
+    const std::span<const uint8_t> bytes = archives_[e->archive].file.bytes();
+    const uint64_t stored = packed ? packed : unpacked;
+    if (offset > bytes.size() || bytes.size() - offset < stored) {
+        logger::warn(std::format("BA2 {}: {} lies past the end of the archive", archives_[e->archive].name, path));
+        return false;
+    }
+    const uint8_t* src = bytes.data() + offset;
+    if (!packed) {
+        out.assign(src, src + unpacked);
+        return true;
+    }
+    if (!inflate_zlib(src, packed, unpacked, out)) {
+        logger::warn(std::format("BA2 {}: {} does not inflate", archives_[e->archive].name, path));
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+std::string GeneralArchives::source(std::string_view path) const
+{
+    FileOrigin o;
+    return origin(path, o) ? o.source : std::string();
+}
+
+bool GeneralArchives::origin(std::string_view path, FileOrigin& out) const
+{
+    out = {};
+    if (path.empty()) return false;
+    std::error_code ec;
+    if (const std::filesystem::path loose = loosePath(path); std::filesystem::is_regular_file(loose, ec)) {
+        out.source = "loose";
+        out.size = std::filesystem::file_size(loose, ec);
+        if (!ec) out.mtime = std::filesystem::last_write_time(loose, ec).time_since_epoch().count();
+        return true;
+    }
+    const Entry* e = find(path);
+    if (!e) return false;
+    const Archive& a = archives_[e->archive];
+    out = { a.name, a.size, a.mtime };
+    return true;
+}
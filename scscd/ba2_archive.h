@@ -0,0 +1,103 @@
+#pragma once
+
+#include "mapped_file.h"
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// BA2 archives as Fallout 4 writes them, and a reader for the files in general (GNRL) ones. Nothing
+// here depends on the game, so the same code runs in the plugin and in the scscd-scan tool.
+
+struct BA2Header {
+    char     magic[4];        // "BTDX" (some docs flip to "BDTX")
+    uint32_t version;         // 1, or 7/8 for archives from the next-gen update
+    char     type[4];         // "GNRL" or "DX10"
+    uint32_t fileCount;
+    uint64_t nameTableOffset; // absolute file offset of the name table
+};
+
+// The file records follow the header. GNRL records are fixed size; a DX10 record is a fixed part
+// followed by one chunk header per mip chunk. Both begin with the same three hashes.
+static constexpr size_t BA2_GNRL_RECORD = 36;
+static constexpr size_t BA2_DX10_RECORD = 24;
+static constexpr size_t BA2_DX10_CHUNK = 24;
+
+// Whether the record table of an archive of this version is laid out as above.
+inline bool ba2_known_version(uint32_t version) { return version == 1 || version == 7 || version == 8; }
+
+// The archive's own hash: CRC-32 (reflected, polynomial 0xEDB88320) with a zero seed and no final
+// XOR, over the lowercased string with '\' separators.
+uint32_t ba2_hash(std::string_view s);
+
+// What a file record identifies a path by: its directory and file stem, each hashed as above, and
+// up to 4 characters of extension, lowercased, packed little-endian.
+struct BA2PathHashes {
+    uint32_t dir;
+    uint32_t file;
+    uint32_t ext;
+};
+BA2PathHashes ba2_path_hashes(std::string_view path);
+
+// Orders a Data folder's archives the way the game loads them, so that where two have the same
+// file, the later one wins: archives that don't belong to a plugin first (the INI lists, with the
+// base game's), by name, then each plugin's own ("<plugin> - Main.ba2" and so on) in `plugins`
+// order. `plugins` are file names in load order.
+std::vector<std::filesystem::path> ba2_load_order(std::vector<std::filesystem::path> archives, std::span<const std::string> plugins);
+
+// Where GeneralArchives would read a file from, and enough to tell later whether what it read
+// could have changed: the loose file's size and modification time, or those of its archive.
+struct FileOrigin {
+    std::string source; // "loose", or the archive's file name
+    uint64_t size{ 0 };
+    int64_t mtime{ 0 };
+
+    bool operator==(const FileOrigin&) const = default;
+};
+
+// Reads files by their path relative to Data: a loose file if there is one, otherwise the copy in
+// the last general archive that has it. Each archive is mapped and only its record table is read
+// when it is opened; a file's bytes are copied, or inflated, straight out of the mapping when it
+// is read. Texture (DX10) archives are skipped, as are versions we don't know.
+//
+// Read-only once open() returns, so read() may be called from any number of threads.
+class GeneralArchives {
+public:
+    // Opens `archives`, given in load order (see ba2_load_order()). Loose files are looked for
+    // under `dataDir`. Call once.
+    void open(const std::filesystem::path& dataDir, std::span<const std::filesystem::path> archives);
+
+    // Reads the whole file into `out`. False if it exists nowhere, or its archive entry is damaged.
+    bool read(std::string_view path, std::vector<uint8_t>& out) const;
+
+    // Where read() would get the file from: "loose", an archive's file name, or empty.
+    std::string source(std::string_view path) const;
+
+    // The same, with the fingerprint of the loose file or archive. False if it exists nowhere.
+    bool origin(std::string_view path, FileOrigin& out) const;
+
+    size_t archives() const { return archives_.size(); }
+    size_t files() const { return entries_.size(); }
+
+private:
+    struct Archive {
+        MappedFile file;
+        std::string name;
+        uint64_t size;
+        int64_t mtime;
+    };
+    struct Entry {
+        BA2PathHashes key;
+        uint32_t archive;
+        const uint8_t* record; // into the archive's mapping
+    };
+
+    const Entry* find(std::string_view path) const;
+    std::filesystem::path loosePath(std::string_view path) const;
+
+    std::filesystem::path data_;
+    std::vector<Archive> archives_;
+    std::vector<Entry> entries_; // sorted by key, one per key: the last archive's
+};
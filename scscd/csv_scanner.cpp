@@ -1,6 +1,9 @@
 #include "scscd.h"
 #include "csv_scanner.h"
 #include "armor_index.h"
+#include "esl_compaction.h"
+#include "plugin_parser.h"
+#include <mutex>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -104,7 +107,29 @@ std::vector<std::string> csv_parse_line(const std::string& input)
 }
 
 
-RE::TESForm* FindFormByFormIDOrEditorID(std::string& plugin_file, std::string& idString, RE::ENUM_FORM_ID expectedFormType, bool logOnMissing) {
+uint32_t OriginalObjectID(RE::TESFile* file, uint32_t compactedID) {
+    // The occupation, clothing and exclusion CSVs are read by concurrent stages of the startup
+    // task graph, so the tables are guarded. The lock is held while a plugin's table is built,
+    // which happens once per light plugin a CSV names by form ID.
+    static std::mutex m;
+    static std::unordered_map<const RE::TESFile*, EslCompaction> tables;
+    std::lock_guard lock(m);
+    auto it = tables.find(file);
+    if (it == tables.end()) {
+        std::vector<uint32_t> ids;
+        if (!read_new_object_ids(DataPath(file->filename), ids))
+            logger::warn(std::format("could not read the records of {}; its light form IDs will not resolve", file->filename));
+        const size_t records = ids.size();
+        it = tables.emplace(file, EslCompaction(std::move(ids))).first;
+        if (it->second.overflow())
+            logger::debug(std::format("{} adds {} records, too many to compact; its light form IDs will not resolve", file->filename, records));
+        else
+            logger::debug(std::format("{}: ESL compaction renumbers {} records", file->filename, it->second.moved()));
+    }
+    return it->second.original(compactedID);
+}
+
+RE::TESForm* FindFormByFormIDOrEditorID(std::string& plugin_file, std::string& idString, std::initializer_list<RE::ENUM_FORM_ID> expectedFormTypes, bool logOnMissing) {
     RE::TESForm* form = NULL;
     if (isFormIDString(idString)) {
         uint32_t formid = 0;
@@ -119,15 +144,30 @@ RE::TESForm* FindFormByFormIDOrEditorID(std::string& plugin_file, std::string& i
         // At this point we've parsed a form ID and an occupation.
         // Try to find the formID within the plugin file.
         logger::trace(std::format("lookup formid: {}, {:#10x}", plugin_file, formid));
-        form = LookupFormInFile<RE::TESForm>(std::string_view(plugin_file), formid);
+        bool translated = false;
+        form = LookupFormInFile<RE::TESForm>(std::string_view(plugin_file), formid, &translated);
         if (form == NULL) {
             if (logOnMissing)
                 logger::error(std::format("skipped: form ID {:#x} could not be found in plugin {}", formid, plugin_file));
             return NULL;
         }
+        // EslCompaction reconstructs xEdit's renumbering rather than reading it from anywhere, so a
+        // plugin compacted some other way would have its light IDs land on the wrong forms. The
+        // form type is the one thing here that can show it.
+        if (translated && std::find(expectedFormTypes.begin(), expectedFormTypes.end(), form->GetFormType()) == expectedFormTypes.end()) {
+            std::string expected;
+            for (RE::ENUM_FORM_ID type : expectedFormTypes) expected += std::format("{}{:#06x}", expected.empty() ? "" : " or ", (uint32_t)type);
+            logger::warn(std::format("light form ID {:#010x} translated to {:#010x} in full plugin {}, which has type {:#06x} rather than {}; "
+                "the plugin may not have been compacted the way scscd assumes", formid, form->GetFormID(), plugin_file, (uint32_t)form->GetFormType(), expected));
+        }
     }
     else {
-        uint32_t formID = ArmorIndex::getFormByTypeAndEdid(expectedFormType, idString, logOnMissing);
+        // One lookup finds every form by this name; the first expected type that has one wins.
+        EdidTable::Match match = ArmorIndex::findFormsByEdid(plugin_file, idString);
+        uint32_t formID = 0;
+        for (RE::ENUM_FORM_ID type : expectedFormTypes) {
+            if ((formID = match.formID(type)) != 0) break;
+        }
         if (formID == 0) {
             if (logOnMissing)
                 logger::error(std::format("skipped: form editor ID {} could not be resolved to a form ID!", idString));
@@ -2,6 +2,7 @@
 
 #include "scscd.h"
 #include "armor_index.h"
+#include "plugin_registry.h"
 //#include <RE/Bethesda/BSTList.h>
 #include <windows.h>
 #include <iostream>
@@ -84,6 +85,17 @@ static std::vector<std::string> split_and_trim(const std::string& input, char de
     return result;
 }
 
+// How CSV columns that name forms are read, by the scanners and by the EDID pre-pass alike, so
+// the pre-pass asks for exactly the IDs the scanners will look up. Occupation and exclusion CSVs
+// name one form per line; the armor and omod columns of a tuple CSV list several, split on ';'.
+inline std::string csv_form_id(const std::string& column) {
+    return trim(column);
+}
+
+inline std::vector<std::string> csv_form_id_list(const std::string& column) {
+    return split_and_trim(column, ';');
+}
+
 static std::optional<std::uint32_t> hex_to_u32(std::string_view s) {
     // Allow optional "0x" / "0X"
     if (s.size() >= 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
@@ -124,28 +136,6 @@ static std::string file_basename(std::string& s) {
     return std::filesystem::path(s).filename().string();
 }
 
-static bool IsLight(const RE::TESFile *file) {
-    return file->compileIndex == 0xFE;
-}
-
-static uint32_t MakeRuntimeFormID(const RE::TESFile* file, uint32_t csvIdLocalOrRuntimeGuess)
-{
-    // Clear any pasted load-order prefix
-    uint32_t localId = csvIdLocalOrRuntimeGuess & 0x00FFFFFFu;
-
-    if (file && IsLight(file)) {
-        // ESL / ESL-flagged: FE | smallIndex | 12-bit local
-        const std::uint16_t smallID = file->GetSmallFileCompileIndex(); // 0..0x0FFF
-        localId &= 0x00000FFFu;
-        return 0xFE000000u | (static_cast<uint32_t>(smallID) << 12) | localId;
-    }
-    else {
-        // Full ESM/ESP: (compileIndex << 24) | low 24 bits
-        const std::uint8_t idx = file ? file->GetCompileIndex() : 0xFF; // 0xFF = invalid
-        return (static_cast<uint32_t>(idx) << 24) | (localId & 0x00FFFFFFu);
-    }
-}
-
 static bool istartswith(std::string_view a, std::string_view b) {
     if (a.size() < b.size()) return false;
     for (size_t i = 0; i < a.size() && i < b.size(); ++i) {
@@ -157,78 +147,68 @@ static bool istartswith(std::string_view a, std::string_view b) {
 }
 
 static RE::TESFile* FindTESFileByName(std::string_view plugin) {
-    logger::trace(std::format("> FindTESFileByName {}", plugin));
-    auto* dh = RE::TESDataHandler::GetSingleton();
-    if (!dh) return nullptr;
-
-    const auto iequals = [](std::string_view a, std::string_view b) {
-        if (a.size() != b.size()) return false;
-        for (size_t i = 0; i < a.size(); ++i) {
-            unsigned char ca = static_cast<unsigned char>(a[i]);
-            unsigned char cb = static_cast<unsigned char>(b[i]);
-            if ((ca | 32) != (cb | 32)) return false;
-        }
-        return true;
-        };
-
-    const auto try_match = [&](RE::TESFile* f) -> RE::TESFile* {
-        if (!f) return nullptr;
-        std::string_view name = f->GetFilename();
-        name = std::string_view(name.data(), std::char_traits<char>::length(name.data()));
-        return iequals(name, plugin) ? f : nullptr;
-        };
-
-    // Full (non-light) files
-    for (RE::TESFile* f : dh->compiledFileCollection.files) {
-        if (auto* hit = try_match(f)) {
-            logger::trace("< FindTESFileByName found");
-            return hit;
-        }
-    }
-    // Light (ESL / ESL-flagged)
-    if constexpr (requires { dh->compiledFileCollection.smallFiles; }) {
-        for (RE::TESFile* f : dh->compiledFileCollection.smallFiles) {
-            if (auto* hit = try_match(f)) {
-                logger::trace("< FindTESFileByName found (light)");
-                return hit;
-            }
-        }
-    }
-
-    logger::trace("< FindTESFileByName not found");
-    return nullptr;
+    const PluginRegistry& registry = PluginRegistry::Instance();
+    const uint16_t ordinal = registry.find(plugin);
+    logger::trace(std::format("FindTESFileByName {} => {}", plugin, ordinal == PluginRegistry::NONE ? "not found" : "found"));
+    return ordinal == PluginRegistry::NONE ? nullptr : registry[ordinal].file;
 }
 
+// Object ID in the plugin as it is on disk of the record that ESL compaction would number
+// `compactedID`, or 0 if there is none. Only meaningful for plugins that are loaded as full
+// plugins; the table is built from the plugin file on first use and kept for later lookups.
+uint32_t OriginalObjectID(RE::TESFile* file, uint32_t compactedID);
+
 template <class T = RE::TESForm>
-static T* LookupFormInFile(std::string_view plugin, uint32_t csvIdLocalOrRuntimeGuess) {
+static T* LookupFormInFile(std::string_view plugin, uint32_t csvIdLocalOrRuntimeGuess, bool* translated = nullptr) {
     // Problem: many/most clothing mods are distributed as full ESPs. But people who run a lot of them
     // (me included) flag them as ESLs. When that happens the form IDs are compacted and effectively
     // renamed. So, the form IDs in presented to us here could be either the original form IDs
-    // (fine) or the newly compacted form IDs. Luckily, the compaction process seems deterministic,
-    // so two users with separate compaction processes SHOULD produce the same compacted form IDs.
-    // In practice I think this means we can get away with placing both original and compacted
-    // form IDs into the same CSV file. But I don't want to log a bunch of warnings for missing
-    // forms when this is now intended behavior. So, we can interrogate the plugin file itself
-    // (if found). If the plugin is light, then we'll skip non-light forms and only warn on
-    // missing light forms. If the plugin isn't light, then we'll skip light forms and only warn
-    // on missing full forms. In both cases, if we omit an opposite, we'll log it as debug,
-    // that way verbose logging can still catch them in a pinch.
+    // (fine) or the newly compacted form IDs. Luckily, the compaction process is deterministic,
+    // so two users with separate compaction processes produce the same compacted form IDs, and
+    // CSV files carry both the original and the compacted form IDs.
+    //
+    // How do we know whether we were given a light or full form ID? We don't know the plugin
+    // order so we skip and re-compute the first two nibbles in all cases. But the author of the
+    // CSV does know whether they are filling in a light or full form. So they can enter the first
+    // two nibbles as FE, same as the engine does. Thus, any form in the CSV which begins 0xFExxxxxx
+    // is light.
     //
-    // Now there is one caveat. How do we know whether we were given a light or full form ID?
-    // Well, we don't know the plugin order so we skip and re-compute the first two nibbles
-    // in all cases. But the author of the CSV does know whether they are filling in a light
-    // or full form. So they can enter the first two nibbles as FE, same as the engine does.
-    // Thus, any form in the CSV which begins 0xFExxxxxx is light.
+    // If the plugin is loaded as a full plugin, a light form ID is translated back to the original
+    // through the plugin's compaction table (see EslCompaction), so it resolves to the same form
+    // as its original. If the plugin is loaded as a light plugin, it is the compacted copy, and an
+    // original form ID that doesn't fit in an ESL can't be in it: that one is skipped without a
+    // lookup. Either way, only a form that should be there and isn't is logged as an error.
+    // `translated`, if given, is set when the ID went through the compaction table.
 
     // special case
     logger::trace(std::format("> LookupFormInFile {}, {:#010x}", plugin, csvIdLocalOrRuntimeGuess));
+    if (translated) *translated = false;
     if (plugin == "Fallout4.esm") {
         const auto runtimeId = csvIdLocalOrRuntimeGuess & 0x00FFFFFF;
         logger::trace(std::format("< LookupFormInFile => base game, {:#010x}", runtimeId));
         return RE::TESForm::GetFormByID(runtimeId);
     }
-    if (auto* file = FindTESFileByName(plugin)) {
-        const auto runtimeId = MakeRuntimeFormID(file, csvIdLocalOrRuntimeGuess);
+    const PluginRegistry& registry = PluginRegistry::Instance();
+    if (const uint16_t ordinal = registry.find(plugin); ordinal != PluginRegistry::NONE) {
+        RE::TESFile* file = registry[ordinal].file;
+        const bool light = registry[ordinal].light;
+        const bool csvLight = (csvIdLocalOrRuntimeGuess >> 24) == 0xFE;
+        uint32_t localId = csvIdLocalOrRuntimeGuess;
+        if (csvLight && !light) {
+            localId = OriginalObjectID(file, csvIdLocalOrRuntimeGuess);
+            if (localId == 0) {
+                logger::debug(std::format("light form {:#010x} has no counterpart in full plugin {}", csvIdLocalOrRuntimeGuess, plugin));
+                return nullptr;
+            }
+            logger::trace(std::format("  light form {:#010x} is {:#08x} in full plugin {}", csvIdLocalOrRuntimeGuess, localId, plugin));
+            if (translated) *translated = true;
+        }
+        else if (!csvLight && light && (csvIdLocalOrRuntimeGuess & 0x00FFFFFF) > 0xFFF) {
+            logger::debug(std::format("full form {:#010x} cannot be in light plugin {}", csvIdLocalOrRuntimeGuess, plugin));
+            return nullptr;
+        }
+        // Any load-order prefix the CSV author pasted is replaced by this session's.
+        const auto runtimeId = registry.runtimeID(ordinal, localId);
         logger::trace(std::format("< LookupFormInFile => {:#010x}", runtimeId));
         if (auto* base = RE::TESForm::GetFormByID(runtimeId)) {
             // kNONE from TESForm base class means any form is valid
@@ -239,23 +219,8 @@ static T* LookupFormInFile(std::string_view plugin, uint32_t csvIdLocalOrRuntime
             }
             return base->As<T>();  // safe RTTI cast
         }
-        else {
-            // at this point the form isn't found; we only need to decide at what level to
-            // log it.
-            if (IsLight(file) && (csvIdLocalOrRuntimeGuess & 0xFE) == 0xFE) {
-                // light plugin & expected light form is missing
-                logger::error(std::format("form {:#010x} not found in expected plugin {}", runtimeId, plugin));
-            }
-            else if (!IsLight(file) && (csvIdLocalOrRuntimeGuess & 0xFE) != 0xFE) {
-                // standard plugin & expected full form is missing
-                logger::error(std::format("form {:#010x} not found in expected plugin {}", runtimeId, plugin));
-            }
-            else {
-                // form type doesn't match plugin type.
-                logger::debug(std::format("form {:#010x} not found in expected plugin {}", runtimeId, plugin));
-            }
-            return nullptr;
-        }
+        logger::error(std::format("form {:#010x} not found in expected plugin {}", runtimeId, plugin));
+        return nullptr;
     }
     logger::warn(std::format("Plugin {} does not appear to have been loaded (this might just mean mod is not installed/enabled)", plugin));
     return nullptr;
@@ -273,7 +238,14 @@ static bool isFormIDString(const std::string& s)
         });
 }
 
-RE::TESForm* FindFormByFormIDOrEditorID(std::string& plugin_file, std::string& idString, RE::ENUM_FORM_ID expectedFormType, bool logOnMissing = true);
+// expectedFormTypes is the order of preference when the same editor ID is used by forms of
+// several types. Form IDs are returned whatever their type; a compacted form ID translated to a
+// form of none of these types is logged, as a sign the compaction table is wrong for the plugin.
+RE::TESForm* FindFormByFormIDOrEditorID(std::string& plugin_file, std::string& idString, std::initializer_list<RE::ENUM_FORM_ID> expectedFormTypes, bool logOnMissing = true);
+
+static RE::TESForm* FindFormByFormIDOrEditorID(std::string& plugin_file, std::string& idString, RE::ENUM_FORM_ID expectedFormType, bool logOnMissing = true) {
+    return FindFormByFormIDOrEditorID(plugin_file, idString, { expectedFormType }, logOnMissing);
+}
 
 template<class T>
 static std::vector<T*> parseFormIDs(std::string &plugin_file, std::vector<std::string>& formIDs) {
@@ -309,6 +281,11 @@ public:
 };
 
 void scan_occupations_csv(std::filesystem::path basedir, OccupationIndex& index);
-void scan_tuples_csv(std::filesystem::path basedir, bool nsfw, ArmorIndex& index, std::unordered_map<std::string, Taxon>& taxonomy);
+void scan_tuples_csv(std::filesystem::path basedir, bool nsfw, ArmorIndex& index, std::unordered_map<std::string, Taxon>& taxonomy, bool discoverOmods = false);
 void scan_exclusions_csv(std::filesystem::path basedir, std::unordered_set<uint32_t>& exclusionList);
 void scan_taxonomies_csv(std::filesystem::path basedir, std::unordered_map<std::string, Taxon>& index);
+
+// Pre-pass used for scoped EDID lookup: collect the editor IDs each kind of CSV file refers to.
+void collect_tuple_edids(std::filesystem::path basedir, EdidRequests& requests);
+void collect_occupation_edids(std::filesystem::path basedir, EdidRequests& requests);
+void collect_exclusion_edids(std::filesystem::path basedir, EdidRequests& requests);
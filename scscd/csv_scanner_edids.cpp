@@ -0,0 +1,67 @@
+#include "scscd.h"
+#include "csv_scanner.h"
+
+// CSV header lines, as recognized by the individual scanners.
+static bool is_csv_header(const std::vector<std::string>& columns) {
+    return iequals(columns[0], "sex") || iequals(columns[0], "occupation") || iequals(columns[0], "NPC Form or Editor ID");
+}
+
+// Occupations and exclusions may name a class, a faction or an NPC.
+static const uint32_t OCCUPATION_FORM_TYPES = FormTypeBit(RE::ENUM_FORM_ID::kCLAS) | FormTypeBit(RE::ENUM_FORM_ID::kFACT) | FormTypeBit(RE::ENUM_FORM_ID::kNPC_);
+
+struct EdidColumn {
+    size_t column;
+    uint32_t types; // FormTypeBit mask
+    bool list;      // several IDs split on ';', as csv_form_id_list() reads them
+};
+
+// Pre-pass over a directory of <plugin>.csv files: records every editor ID found in the given
+// columns against the plugin the file is named after. Nothing is resolved and nothing is
+// validated beyond what is needed to find the columns; the real scanners still report
+// malformed lines.
+static void collect_csv_edids(std::filesystem::path basedir, std::initializer_list<EdidColumn> edidColumns, EdidRequests& requests) {
+    std::vector<std::string> filenames = scandir(basedir, ".csv");
+    for (std::string filename : filenames) {
+        std::filesystem::path fullpath = basedir / filename;
+        std::ifstream file(fullpath);
+        if (!file) continue;
+
+        std::string plugin_file = file_basename(filename);
+        remove_suffix_icase(plugin_file, ".csv");
+        std::transform(plugin_file.begin(), plugin_file.end(), plugin_file.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        auto& wanted = requests[plugin_file];
+
+        std::string line;
+        while (std::getline(file, line)) {
+            // strip comments
+            if (size_t n = line.find('#'); n != std::string::npos)
+                line = line.substr(0, n);
+            std::vector<std::string> columns = csv_parse_line(line);
+            if (is_csv_header(columns))
+                continue;
+            for (const EdidColumn& c : edidColumns) {
+                if (columns.size() <= c.column) continue;
+                const std::vector<std::string> ids = c.list ? csv_form_id_list(columns[c.column]) : std::vector{ csv_form_id(columns[c.column]) };
+                for (const std::string& idString : ids) {
+                    if (!idString.empty() && !isFormIDString(idString))
+                        wanted[idString] |= c.types;
+                }
+            }
+        }
+    }
+}
+
+void collect_tuple_edids(std::filesystem::path basedir, EdidRequests& requests) {
+    // Sexes,Occupation,FormOrEditorIDs[,Level][,OModIDs][,ClothingTypeID]
+    collect_csv_edids(basedir, { { 2, FormTypeBit(RE::ENUM_FORM_ID::kARMO), true }, { 4, FormTypeBit(RE::ENUM_FORM_ID::kOMOD), true } }, requests);
+}
+
+void collect_occupation_edids(std::filesystem::path basedir, EdidRequests& requests) {
+    // Occupation,FormOrEditorID
+    collect_csv_edids(basedir, { { 1, OCCUPATION_FORM_TYPES, false } }, requests);
+}
+
+void collect_exclusion_edids(std::filesystem::path basedir, EdidRequests& requests) {
+    // FormOrEditorID
+    collect_csv_edids(basedir, { { 0, OCCUPATION_FORM_TYPES, false } }, requests);
+}
@@ -44,10 +44,8 @@ void scan_exclusions_csv(std::filesystem::path basedir, std::unordered_set<uint3
                 continue;
             }
 
-            std::string idString = trim(columns[0]);
-            RE::TESForm* form = FindFormByFormIDOrEditorID(plugin_file, idString, RE::TESClass::FORM_ID, /*logOnMissing*/ false);
-            if (!form) form = FindFormByFormIDOrEditorID(plugin_file, idString, RE::TESFaction::FORM_ID, /*logOnMissing*/ false);
-            if (!form) form = FindFormByFormIDOrEditorID(plugin_file, idString, RE::TESNPC::FORM_ID, /*logOnMissing*/ false);
+            std::string idString = csv_form_id(columns[0]);
+            RE::TESForm* form = FindFormByFormIDOrEditorID(plugin_file, idString, { RE::TESClass::FORM_ID, RE::TESFaction::FORM_ID, RE::TESNPC::FORM_ID }, /*logOnMissing*/ false);
             if (!form) {
                 logger::warn(std::format("Form with ID {} for exclusion list was NOT FOUND", idString) + CSV_LINENO);
                 continue;
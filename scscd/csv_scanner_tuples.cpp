@@ -1,10 +1,33 @@
 #include "scscd.h"
 #include "csv_scanner.h"
+#include "omod_index.h"
+#include <array>
+#include <map>
 
-void scan_tuples_csv(std::filesystem::path basedir, bool nsfw, ArmorIndex& index, std::unordered_map<std::string, Taxon> &taxonomy) {
+// How a line writes its form IDs. Files for plugins that users commonly ESL-flag list each set
+// twice, once with the original form IDs and once with the compacted (FE-prefixed) ones; the two
+// copies are told apart by this. A line that only names editor IDs has no twin.
+enum class IdSpelling { EditorIDs, Original, Compacted };
+
+static IdSpelling spelling_of(std::initializer_list<const std::vector<std::string>*> idLists) {
+    IdSpelling spelling = IdSpelling::EditorIDs;
+    for (const std::vector<std::string>* ids : idLists) {
+        for (const std::string& id : *ids) {
+            if (!isFormIDString(id)) continue;
+            if (iequals(std::string_view(id).substr(0, 2), "FE")) return IdSpelling::Compacted;
+            spelling = IdSpelling::Original;
+        }
+    }
+    return spelling;
+}
+
+void scan_tuples_csv(std::filesystem::path basedir, bool nsfw, ArmorIndex& index, std::unordered_map<std::string, Taxon> &taxonomy, bool discoverOmods) {
     logger::info("Loading tuples from " + basedir.string());
     std::vector<std::string> filenames = scandir(basedir, ".csv");
     for (std::string filename : filenames) {
+        // Per set (level, nsfw, sexes, occupations, armors, 0, omods; clothing type): how many
+        // lines so far wrote it with original form IDs and how many with compacted ones.
+        std::map<std::pair<std::vector<uint32_t>, std::string>, std::array<uint32_t, 2>> written;
         uint32_t count = 0;
         std::filesystem::path fullpath = basedir / filename;
         logger::debug("Parsing tuples file " + fullpath.string());
@@ -69,7 +92,7 @@ void scan_tuples_csv(std::filesystem::path basedir, bool nsfw, ArmorIndex& index
             }
 
             std::string formIDsString = columns[2];
-            std::vector<std::string> formIDs = split_and_trim(formIDsString, ';');
+            std::vector<std::string> formIDs = csv_form_id_list(formIDsString);
             if (formIDs.size() == 0) {
                 logger::error(std::string("skipped: no form IDs in column 2") + CSV_LINENO);
                 continue;
@@ -87,8 +110,9 @@ void scan_tuples_csv(std::filesystem::path basedir, bool nsfw, ArmorIndex& index
 
             // optional omods list (Form or editor IDs)
             std::vector<RE::BGSMod::Attachment::Mod*> omods;
+            std::vector<std::string> omodIDs;
             if (columns.size() >= 5) {
-                std::vector<std::string> omodIDs = split_and_trim(columns[4], ';');
+                omodIDs = csv_form_id_list(columns[4]);
                 if (omodIDs.size() > 0) {
                     omods = parseFormIDs<RE::BGSMod::Attachment::Mod>(plugin_file, omodIDs);
                 }
@@ -103,6 +127,27 @@ void scan_tuples_csv(std::filesystem::path basedir, bool nsfw, ArmorIndex& index
                     localNSFW = false;
             }
 
+            // Both copies of a set written with original and with compacted form IDs resolve to
+            // the same forms, so the second of the two is skipped. A set written the same way
+            // more than once is kept every time, since that is how a file weights it.
+            if (const IdSpelling spelling = spelling_of({ &formIDs, &omodIDs }); spelling != IdSpelling::EditorIDs) {
+                std::vector<uint32_t> set{ level, localNSFW, sexes, occupations };
+                for (RE::TESObjectARMO* armor : armors) set.push_back(armor->GetFormID());
+                std::sort(set.begin() + 4, set.end());
+                set.push_back(0);
+                const size_t omodsAt = set.size();
+                for (RE::BGSMod::Attachment::Mod* omod : omods) set.push_back(omod->GetFormID());
+                std::sort(set.begin() + omodsAt, set.end());
+                std::array<uint32_t, 2>& counts = written[{ std::move(set), columns.size() >= 7 ? columns[6] : std::string() }];
+                const size_t mine = spelling == IdSpelling::Compacted, theirs = !mine;
+                const bool twin = counts[theirs] > counts[mine];
+                counts[mine]++;
+                if (twin) {
+                    logger::debug(std::format("skipped: same set as an earlier line, with {} form IDs", mine ? "original" : "compacted") + CSV_LINENO);
+                    continue;
+                }
+            }
+
             // optional item category name for biped slot override
             if (columns.size() >= 7 && columns[6].size() > 0) {
                 if (taxonomy.contains(columns[6])) {
@@ -146,6 +191,25 @@ void scan_tuples_csv(std::filesystem::path basedir, bool nsfw, ArmorIndex& index
                     logger::warn(std::string("omod registration failed") + CSV_LINENO);
                 }
             }
+            else if (discoverOmods) {
+                // Nothing listed, so use what the plugins say fits. Each armor gets only its own
+                // compatible omods, rather than the union across the set.
+                for (RE::TESObjectARMO* armor : armors) {
+                    std::vector<RE::BGSMod::Attachment::Mod*> compatible;
+                    for (uint32_t omodID : OmodIndex::Instance().CompatibleWith(armor->GetFormID())) {
+                        if (RE::TESForm* form = RE::TESForm::GetFormByID(omodID)) {
+                            if (auto* mod = form->As<RE::BGSMod::Attachment::Mod>())
+                                compatible.push_back(mod);
+                        }
+                    }
+                    if (compatible.empty()) continue;
+                    logger::debug(std::format("discovered {} omods for armor {:#010x}", compatible.size(), armor->GetFormID()) + CSV_LINENO);
+                    std::vector<RE::TESObjectARMO*> single{ armor };
+                    if (!index.registerOmods(single, compatible, localNSFW)) {
+                        logger::warn(std::string("omod registration failed") + CSV_LINENO);
+                    }
+                }
+            }
             count += 1;
         }
         logger::info(std::format("Registered {} sets from file {}", count, filename));
@@ -1,31 +1,16 @@
 #include "scscd.h"
 #include "armor_index.h"
+#include "plugin_format.h"
 
-std::unordered_map<RE::ENUM_FORM_ID, std::unordered_map<std::string, uint32_t>> ArmorIndex::FORMS_BY_EDID_BY_TYPE;
-
-constexpr uint32_t FOURCC(char a, char b, char c, char d) {
-    return (uint32_t(uint8_t(a))) |
-        (uint32_t(uint8_t(b)) << 8) |
-        (uint32_t(uint8_t(c)) << 16) |
-        (uint32_t(uint8_t(d)) << 24);
-}
+EdidTable ArmorIndex::FORMS_BY_EDID;
+std::unordered_map<std::string, EdidTable, EdidHash, EdidEqual> ArmorIndex::FORMS_BY_EDID_BY_PLUGIN;
+bool ArmorIndex::SCOPED_EDIDS = false;
+RecordCatalog ArmorIndex::CATALOG;
 
 //static constexpr std::uint32_t SIG_TES4 = FOURCC('T', 'E', 'S', '4');
 //static constexpr std::uint32_t SIG_GRUP = FOURCC('G', 'R', 'U', 'P');  // chunk id for groups (we'll ignore)
 //static constexpr std::uint32_t SIG_EDID = FOURCC('E', 'D', 'I', 'D');
 //
-static inline std::uint32_t ComposeRuntimeFormID(const RE::TESFile* file, std::uint32_t localID)
-{
-    if (file->IsLight()) {
-        const auto small = file->GetSmallFileCompileIndex() & 0x0FFFu;
-        return 0xFE000000u | (small << 12) | (localID & 0x0FFFu);
-    }
-    else {
-        const auto full = file->GetCompileIndex();
-        return (std::uint32_t(full) << 24) | (localID & 0x00FFFFFFu);
-    }
-}
-
 static inline RE::ENUM_FORM_ID FourCCToFormEnum(std::uint32_t sig)
 {
     switch (sig) {
@@ -45,226 +30,441 @@ static inline RE::ENUM_FORM_ID FourCCToFormEnum(std::uint32_t sig)
 
 #include <cstdint>
 #include <string>
+#include <string_view>
+#include <span>
 #include <unordered_map>
 #include <vector>
-#include <fstream>
-#include <zlib.h> // link zlib
-
-
-struct RecordHeader {
-    char     sig[4];        // e.g. "ARMO", "NPC_", "OMOD", ...
-    uint32_t dataSize;
-    uint32_t flags;
-    uint32_t formID;
-    uint32_t vcInfo1;
-    uint16_t formVersion;
-    uint16_t vcInfo2;
-};
-
-struct GroupHeader {
-    char sig[4];       // "GRUP"
-    uint32_t groupSize;
-    uint32_t label;
-    uint32_t type;
-    uint16_t stamp;
-    uint16_t unknown;
-};
-
-static bool read_exact(std::ifstream& f, void* p, size_t n) {
-    return !!f.read(reinterpret_cast<char*>(p), n);
+#include "async_io.h"
+#include "plugin_parser.h"
+#include "csv_scanner.h"
+#include "thread_pool.h"
+#include "edid_cache.h"
+#include "plugin_reader.h"
+#include "plugin_registry.h"
+#include "plugin_prescan.h"
+#include <atomic>
+#include <optional>
+
+// The parser reports record signatures; the index wants the engine's form types.
+template <class Fn>
+static auto by_form_type(Fn&& fn) {
+    return [fn = std::forward<Fn>(fn)](uint32_t sig, std::string_view edid, uint32_t localID) mutable {
+        return fn(FourCCToFormEnum(sig), edid, localID);
+    };
 }
 
-static std::vector<uint8_t> inflate_zlib(const uint8_t* src, size_t sz, size_t expected) {
-    std::vector<uint8_t> out(expected);
-    z_stream zs{};
-    zs.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(src));
-    zs.avail_in = static_cast<uInt>(sz);
-    zs.next_out = reinterpret_cast<Bytef*>(out.data());
-    zs.avail_out = static_cast<uInt>(out.size());
-    if (inflateInit(&zs) != Z_OK) return {};
-    int ret = inflate(&zs, Z_FINISH);
-    inflateEnd(&zs);
-    if (ret != Z_STREAM_END || zs.total_out != expected) return {};
-    return out;
+// Merges each plugin's catalog into ArmorIndex::CATALOG, in load order so that the last override
+// of a record wins. plugins[i] is the plugin with registry ordinal i. References to (and records
+// of) masters that aren't active resolve to 0 and disappear, as they would in game.
+static void merge_catalogs(RecordCatalog& into, const std::vector<const PluginEdids*>& plugins) {
+    const PluginRegistry& registry = PluginRegistry::Instance();
+    for (uint16_t i = 0; i < plugins.size(); i++) {
+        into.merge(plugins[i]->catalog, [&registry, i](uint32_t localID) { return registry.resolve(i, localID); });
+    }
 }
 
-static inline uint16_t rd_le16(const uint8_t* p) {
-    uint16_t v;
-    std::memcpy(&v, p, sizeof(v));
-    return v;
+// Approximate heap cost of one form in the unordered_map<ENUM_FORM_ID, unordered_map<std::string,
+// uint32_t>> that EdidTable replaced, going by MSVC's layout: a 64-byte list node holding the
+// string and form ID, two bucket pointers, and a heap block for names too long for the string's
+// 15-character small buffer. Only used to report what the change saves.
+static size_t nested_map_form_bytes(size_t nameLength) {
+    size_t bytes = 64 + 2 * sizeof(void*);
+    if (nameLength > 15) bytes += (nameLength + 16) & ~size_t(15);
+    return bytes;
 }
-static inline uint32_t rd_le32(const uint8_t* p) {
-    uint32_t v;
-    std::memcpy(&v, p, sizeof(v));
-    return v;
+
+size_t ScanPluginEdids(std::span<PluginEdids* const> tables, size_t workers) {
+    if (tables.empty()) return 0;
+    // These are mostly plugins that were just installed or updated, so likely not in the file
+    // cache either: read them all at once through the batched reader, rather than faulting them
+    // in one mapping per worker.
+    std::vector<std::filesystem::path> paths;
+    std::vector<RecordCatalog*> catalogs;
+    for (PluginEdids* p : tables) {
+        paths.push_back(DataPath(p->file ? std::string_view(p->file->filename) : std::string_view(p->filename)));
+        catalogs.push_back(&p->catalog);
+        logger::trace(std::format("discovering edids in file {}", p->filename));
+    }
+    scanFormsAndCatalogInFiles(paths, [tables](size_t k, uint32_t sig, std::string_view edid, uint32_t localID) {
+        PluginEdids& p = *tables[k];
+        p.entries.push_back({ FourCCToFormEnum(sig), localID, (uint32_t)p.names.size(), (uint32_t)edid.size() });
+        p.names.append(edid);
+        return true;
+    }, catalogs, AsyncReader::DEFAULT_DEPTH, workers);
+    return std::max<size_t>(workers, 1); // as many as the reader started
 }
 
-// data: the record payload *after* the record header (already decompressed if needed)
-static std::string parse_edid_from_record_bytes(const std::vector<uint8_t>& data)
-{
-    const uint8_t* buf = data.data();
-    const size_t n = data.size();
-
-    size_t off = 0;
-    uint32_t pendingBig = 0; // carries XXXX size to the next subrecord only
-
-    while (off + 6 <= n) {
-        const char* st = reinterpret_cast<const char*>(buf + off);
-        char type[5]{ st[0], st[1], st[2], st[3], 0 };
-        uint16_t sz16 = rd_le16(buf + off + 4);
-        off += 6;
-
-        // XXXX extends size of the *next* subrecord
-        if (std::memcmp(type, "XXXX", 4) == 0) {
-            // Per spec, size must be 4, and payload is a uint32 little-endian
-            if (sz16 != 4 || off + 4 > n) break;
-            pendingBig = rd_le32(buf + off);
-            off += 4;
-            // Loop continues; we do not consume any "real" subrecord yet
-            continue;
+void ArmorIndex::indexAllFormsByTypeAndEdid() {
+    const PluginRegistry& registry = PluginRegistry::Instance();
+    const std::filesystem::path cachePath = DataPath(EDID_CACHE_FILE);
+    auto start = std::chrono::steady_clock::now();
+
+    // Load order: full plugins (masters + ESPs), then light plugins (ESLs), numbered as in the
+    // registry. The merge below walks this same order.
+    std::vector<PluginEdids> plugins(registry.size());
+    for (uint16_t i = 0; i < registry.size(); i++)
+        plugins[i] = { .file = registry[i].file, .filename = registry[i].filename };
+
+    // The pre-scan has normally loaded the cache, and scanned what it was missing, already.
+    EdidCache cache;
+    if (!PluginPrescan::Instance().TakeCache(cache)) cache.load(cachePath);
+    auto loaded = std::chrono::steady_clock::now();
+
+    // Each plugin is fingerprinted and, unless the cache already has a table for that exact
+    // file, queued to be scanned into its own table. Workers share nothing but the counter that
+    // hands out plugins (and the cache, of which each only takes its own entry).
+    std::atomic<size_t> hits{ 0 };
+    std::vector<uint8_t> missed(plugins.size(), 0);
+    parallel_for(plugins.size(), [&plugins, &cache, &hits, &missed](size_t i) {
+        PluginEdids& p = plugins[i];
+        const std::filesystem::path path = DataPath(p.file->filename);
+        if (!PluginFingerprint::of(path, p.fingerprint)) {
+            logger::warn(std::format("cannot access file {}", path.string()));
+            return;
         }
+        if (cache.take(p)) hits++;
+        else missed[i] = 1;
+    });
 
-        // Effective data size for this subrecord
-        uint32_t dsz = pendingBig ? pendingBig : sz16;
-        pendingBig = 0;
-
-        if (off + dsz > n) break; // bounds guard
-
-        if (std::memcmp(type, "EDID", 4) == 0) {
-            // EDID is a Z-string (ASCII/UTF-8) inside dsz bytes.
-            const char* s = reinterpret_cast<const char*>(buf + off);
-            size_t len = 0;
-            while (len < dsz && s[len] != '\0') ++len;
-            return std::string(s, len);
+    std::vector<PluginEdids*> toScan;
+    for (size_t i = 0; i < plugins.size(); i++) {
+        if (missed[i]) toScan.push_back(&plugins[i]);
+    }
+    size_t scanWorkers = ScanPluginEdids(toScan);
+    auto scanned = std::chrono::steady_clock::now();
+
+    // Merge in load order. Within a plugin entries are in record order, so this inserts exactly
+    // the sequence the serial scan used to, and the first plugin to define an EDID still wins.
+    // Every table is complete by now, so the index can be sized once up front. Only records a
+    // plugin adds are counted: an override mostly repeats its master's name, which is kept once.
+    size_t entries = 0, nameBytes = 0;
+    for (uint16_t i = 0; i < plugins.size(); i++) {
+        const size_t masters = registry[i].masters.size();
+        for (const auto& e : plugins[i].entries) {
+            if ((e.localID >> 24) < masters) continue;
+            entries++;
+            nameBytes += e.length;
+        }
+    }
+    FORMS_BY_EDID.reserve(entries, nameBytes);
+    int count = 0;
+    size_t nestedMapBytes = 0;
+    for (uint16_t i = 0; i < plugins.size(); i++) {
+        const PluginEdids& p = plugins[i];
+        for (const auto& e : p.entries) {
+            const uint32_t formid = registry.resolve(i, e.localID);
+            if (formid == 0) continue; // override of a master that isn't active
+            if (FORMS_BY_EDID.insert(e.formtype, p.edid(e), formid)) {
+                //logger::trace(std::format("saw form {:#010x} with type {:#06x} and edid {}", formid, (uint32_t) e.formtype, p.edid(e)));
+                count++;
+                nestedMapBytes += nested_map_form_bytes(e.length);
+            }
         }
-
-        // Skip payload of other subrecords
-        off += dsz;
     }
+    std::vector<const PluginEdids*> order;
+    for (const PluginEdids& p : plugins) order.push_back(&p);
+    merge_catalogs(CATALOG, order);
+    auto merged = std::chrono::steady_clock::now();
+
+    // Rewrite the cache if anything was scanned. Tables of plugins that have gone inactive since
+    // it was saved are carried over, so there's nothing to rewrite for those.
+    const size_t misses = plugins.size() - hits;
+    if (misses > 0) {
+        cache.save(cachePath, plugins);
+    }
+    auto saved = std::chrono::steady_clock::now();
+
+    using std::chrono::milliseconds;
+    logger::info(std::format("scanned {} active plugins and saw {} compatible forms.", plugins.size(), count));
+    logger::info(std::format("EDID index: {} names, {} KB (nested unordered_map<std::string> layout would be ~{} KB)",
+        FORMS_BY_EDID.size(), FORMS_BY_EDID.memoryBytes() / 1024, nestedMapBytes / 1024));
+    logger::info(std::format("armor catalog: {} armors, {} addons, {} omods, {} races; {} KB",
+        CATALOG.armo.formID.size(), CATALOG.arma.formID.size(), CATALOG.omod.formID.size(), CATALOG.race.formID.size(),
+        CATALOG.memoryBytes() / 1024));
+    logger::info(std::format("EDID cache: {} hits, {} misses; load {} ms, scan {} ms on {} reader workers, merge {} ms, save {} ms",
+        hits.load(), misses,
+        duration_cast<milliseconds>(loaded - start).count(),
+        duration_cast<milliseconds>(scanned - loaded).count(), scanWorkers,
+        duration_cast<milliseconds>(merged - scanned).count(),
+        duration_cast<milliseconds>(saved - merged).count()));
+}
 
-    return {}; // no EDID found
+EdidTable::Match ArmorIndex::findFormsByEdid(const std::string& plugin, std::string_view edid) {
+    if (!SCOPED_EDIDS) return FORMS_BY_EDID.find(edid);
+    auto it = FORMS_BY_EDID_BY_PLUGIN.find(std::string_view(plugin));
+    return it == FORMS_BY_EDID_BY_PLUGIN.end() ? EdidTable::Match{} : it->second.find(edid);
 }
 
-static void process_range(RE::TESFile* tesfile,
-                          std::ifstream& f,
-                          std::uint64_t end_offset,
-                          std::function< bool(RE::ENUM_FORM_ID formtype, const std::string& edid, uint32_t formid)> fn)
-{
-    while (true) {
-        auto here = static_cast<std::uint64_t>(f.tellg());
-        if (!f || here >= end_offset) break;
-
-        char tag[4];
-        if (!read_exact(f, tag, 4)) break;
-
-        if (std::memcmp(tag, "GRUP", 4) == 0) {
-            GroupHeader gh;
-            std::memcpy(gh.sig, tag, 4);
-            if (!read_exact(f, reinterpret_cast<char*>(&gh) + 4, sizeof(gh) - 4)) return;
-
-            const std::uint64_t group_start = here;
-            const std::uint64_t group_end = group_start + gh.groupSize;
-            const std::uint64_t payload_beg = here + 24;
-
-            // Top-level groups (type==0): label is record 4CC. Filter here.
-            if (gh.type == 0) {
-                uint32_t label = gh.label; // already little-endian 4CC
-                if (FourCCToFormEnum(label) == RE::ENUM_FORM_ID::kNONE) {
-                    // Skip whole group
-                    f.seekg(group_end, std::ios::beg);
-                    continue;
-                }
-            }
-            else {
-                // Not top-level: if we don't need REFR/ACHR/etc, skip entirely.
-                f.seekg(group_end, std::ios::beg);
-                continue;
-            }
+void ArmorIndex::indexRequestedFormsByPluginAndEdid(const EdidRequests& requests) {
+    const PluginRegistry& registry = PluginRegistry::Instance();
+    const std::filesystem::path cachePath = DataPath(EDID_CACHE_FILE);
+    auto start = std::chrono::steady_clock::now();
+    SCOPED_EDIDS = true;
+
+    // One EDID that one plugin's CSV files asked for. It starts out in the requesting plugin's
+    // wanted list and, for as long as it stays unresolved, moves on to that plugin's masters.
+    struct Request {
+        const std::string* requester;
+        const std::string* edid;
+        uint32_t types;
+        bool resolved{ false };
+    };
+    struct Hit {
+        Request* request;
+        RE::ENUM_FORM_ID formtype;
+        uint32_t formid;
+    };
+    // plugins[i] is the plugin with registry ordinal i.
+    struct Plugin {
+        PluginEdids table;             // file, lowercase filename; entries only if the cache had them
+        int level{ -1 };               // longest chain of dependents above this plugin; -1 = out of scope
+        std::vector<Request*> wanted;
+        std::vector<Hit> hits;
+        bool scanned{ false }, cached{ false }, stoppedEarly{ false };
+    };
 
-            // Recurse into this group's payload
-            f.seekg(payload_beg, std::ios::beg);
-            process_range(tesfile, f, group_end, fn);
+    std::vector<Plugin> plugins(registry.size());
+    for (uint16_t i = 0; i < registry.size(); i++)
+        plugins[i].table = { .file = registry[i].file, .filename = registry[i].filename };
+    const uint16_t base = registry.find("fallout4.esm");
+
+    // Everything a plugin's EDIDs may resolve to lives in the plugin itself, its masters, or the
+    // base game. Masters load (and override) before their dependents, so a plugin is searched
+    // only after every in-scope plugin that depends on it: plugins on the same level never
+    // depend on each other and are searched together.
+    auto enter = [&](auto& self, uint16_t i, int level) -> void {
+        Plugin& p = plugins[i];
+        if (p.level >= level || level > (int)plugins.size()) return;
+        p.level = level;
+        for (uint16_t m : registry[i].masters)
+            if (m != PluginRegistry::NONE) self(self, m, level + 1);
+        if (base != PluginRegistry::NONE && i != base) self(self, base, level + 1);
+    };
 
-            // Ensure we're positioned at the end of this group to continue
-            f.seekg(group_end, std::ios::beg);
+    std::vector<Request> storage;
+    size_t requested = 0;
+    for (const auto& [plugin, edids] : requests) requested += edids.size();
+    storage.reserve(requested);
+    for (const auto& [plugin, edids] : requests) {
+        const uint16_t i = registry.find(plugin);
+        if (i == PluginRegistry::NONE) {
+            logger::debug(std::format("plugin {} not loaded; its EDIDs are not looked up", plugin));
             continue;
         }
-
-        // Record path: we already consumed 4 bytes of signature
-        RecordHeader rh{};
-        std::memcpy(rh.sig, tag, 4);
-        if (!read_exact(f, reinterpret_cast<char*>(&rh) + 4, sizeof(rh) - 4)) return;
-
-        // Read record data buffer (handle compression)
-        std::vector<std::uint8_t> rdata;
-        if (rh.flags & 0x00040000) {
-            std::uint32_t uncompressedSize = 0;
-            if (!read_exact(f, &uncompressedSize, 4)) return;
-            std::vector<std::uint8_t> comp(rh.dataSize - 4);
-            if (!comp.empty() && !read_exact(f, comp.data(), comp.size())) return;
-            rdata = inflate_zlib(comp.data(), comp.size(), uncompressedSize); // your inflater
-            if (rdata.empty()) return; // or continue on error
+        enter(enter, i, 0);
+        for (const auto& [edid, types] : edids) {
+            storage.push_back({ &plugin, &edid, types });
+            plugins[i].wanted.push_back(&storage.back());
         }
-        else {
-            rdata.resize(rh.dataSize);
-            if (rh.dataSize && !read_exact(f, rdata.data(), rdata.size())) return;
+    }
+    int levels = 0;
+    for (const Plugin& p : plugins) levels = std::max(levels, p.level + 1);
+
+    // The pre-scan has normally loaded the cache, and scanned what it was missing, already.
+    EdidCache cache;
+    if (!PluginPrescan::Instance().TakeCache(cache)) cache.load(cachePath);
+
+    // Plugins that aren't cached are read with our own parser, unless SCSCD_RECORD_SOURCE=engine
+    // asks for the engine's reader instead (SCSCD_COMPARE_RECORD_SOURCES shows which is faster).
+    FileRecordSource fileSource(GetDataDir());
+    std::optional<EngineRecordSource> engineSource;
+    if (EngineRecordSourceRequested())
+        engineSource.emplace();
+    RecordSource& source = engineSource ? static_cast<RecordSource&>(*engineSource) : fileSource;
+
+    // Searches one plugin for its still-unresolved requests. Each worker writes only to its own
+    // plugin; requests are only read here and are resolved between levels.
+    auto search = [&](uint16_t ordinal) {
+        Plugin& p = plugins[ordinal];
+        struct Wanted { std::vector<Request*> requests; uint32_t types{ 0 }; bool found{ false }; };
+        std::unordered_map<std::string_view, Wanted, EdidHash, EdidEqual> wanted;
+        uint32_t types = 0;
+        for (Request* r : p.wanted) {
+            if (r->resolved) continue;
+            Wanted& w = wanted[*r->edid];
+            if (std::find(w.requests.begin(), w.requests.end(), r) != w.requests.end()) continue;
+            w.requests.push_back(r);
+            w.types |= r->types;
+            types |= r->types;
         }
+        if (wanted.empty()) return;
+
+        size_t remaining = wanted.size();
+        auto match = [&](RE::ENUM_FORM_ID formtype, std::string_view edid, uint32_t localID) {
+            auto it = wanted.find(edid);
+            if (it == wanted.end() || !(it->second.types & FormTypeBit(formtype))) return true;
+            const uint32_t formid = registry.resolve(ordinal, localID);
+            if (formid == 0) return true;
+            for (Request* r : it->second.requests) {
+                if (r->types & FormTypeBit(formtype))
+                    p.hits.push_back({ r, formtype, formid });
+            }
+            if (!it->second.found) {
+                it->second.found = true;
+                if (--remaining == 0) {
+                    p.stoppedEarly = true;
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        p.scanned = true;
+        const std::filesystem::path path = DataPath(p.table.file->filename);
+        if (PluginFingerprint::of(path, p.table.fingerprint) && cache.take(p.table)) {
+            p.cached = true;
+            for (const auto& e : p.table.entries) {
+                if (!match(e.formtype, p.table.edid(e), e.localID)) break;
+            }
+            return;
+        }
+        logger::trace(std::format("looking up {} edids in file {}", wanted.size(), p.table.file->filename));
+        source.scan(p.table.file->filename, by_form_type(match), types);
+    };
 
-        // Parse subrecords in rdata (your existing EDID scan with XXXX handling)
-        std::string edid = parse_edid_from_record_bytes(rdata); // keep your logic
-        if (!edid.empty()) {
-            const uint32_t fourcc = FOURCC(rh.sig[0], rh.sig[1], rh.sig[2], rh.sig[3]);
-            if (!fn(FourCCToFormEnum(fourcc), edid, ComposeRuntimeFormID(tesfile, rh.formID))) {
-                logger::trace("callback indicated to cease iteration");
-                break;
+    size_t nestedMapBytes = 0;
+    for (int level = 0; level < levels; level++) {
+        std::vector<size_t> batch;
+        for (size_t i = 0; i < plugins.size(); i++) {
+            if (plugins[i].level == level && !plugins[i].wanted.empty())
+                batch.push_back(i);
+        }
+        parallel_for(batch.size(), [&](size_t b) { search((uint16_t)batch[b]); }, source.concurrent() ? worker_count() : 1);
+
+        // Later plugins override earlier ones, so when two plugins on one level both define an
+        // EDID, the one further down the load order wins.
+        for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+            for (const Hit& h : plugins[*it].hits)
+                if (FORMS_BY_EDID_BY_PLUGIN[*h.request->requester].insert(h.formtype, *h.request->edid, h.formid))
+                    nestedMapBytes += nested_map_form_bytes(h.request->edid->size());
+        }
+        for (size_t i : batch) {
+            for (const Hit& h : plugins[i].hits) h.request->resolved = true;
+        }
+        // Whatever is still unresolved moves on to the masters.
+        for (size_t i : batch) {
+            Plugin& p = plugins[i];
+            for (Request* r : p.wanted) {
+                if (r->resolved) continue;
+                for (uint16_t m : registry[(uint16_t)i].masters)
+                    if (m != PluginRegistry::NONE) plugins[m].wanted.push_back(r);
+                if (base != PluginRegistry::NONE && i != base) plugins[base].wanted.push_back(r);
             }
         }
     }
-}
 
-static void scanFormsInFile(RE::TESFile* tesfile, std::function< bool(RE::ENUM_FORM_ID formtype, const std::string& edid, uint32_t formid)> fn) {
-    logger::trace(std::format("discovering edids in file {}", tesfile->filename));
-
-    std::filesystem::path path = DataPath(tesfile->filename);
-    std::ifstream f(path, std::ios::binary);
-    if (!f) {
-        logger::warn(std::format("cannot access file {}", path.string()));
-        return;
+    // The armor catalog can't be scoped like this: an addon or race that a requested armor uses
+    // may be overridden by any plugin at all. So every active plugin contributes, but only its
+    // armor, addon, omod and race groups are read, and cached plugins cost nothing.
+    auto resolvedAt = std::chrono::steady_clock::now();
+    std::atomic<size_t> catalogHits{ 0 };
+    parallel_for(plugins.size(), [&](size_t i) {
+        Plugin& p = plugins[i];
+        if (p.cached) {
+            catalogHits++;
+            return;
+        }
+        const std::filesystem::path path = DataPath(p.table.file->filename);
+        if (!p.scanned && PluginFingerprint::of(path, p.table.fingerprint) && cache.take(p.table)) {
+            catalogHits++;
+            return;
+        }
+        scanFormsAndCatalogInFile(path, [](uint32_t, std::string_view, uint32_t) { return true; },
+            p.table.catalog, CATALOG_RECORD_TYPES);
+    });
+    std::vector<const PluginEdids*> order;
+    for (const Plugin& p : plugins) order.push_back(&p.table);
+    merge_catalogs(CATALOG, order);
+
+    size_t resolved = 0, inScope = 0, scanned = 0, cached = 0, stoppedEarly = 0, tableBytes = 0;
+    for (const Request& r : storage) resolved += r.resolved;
+    for (const auto& [plugin, table] : FORMS_BY_EDID_BY_PLUGIN) tableBytes += table.memoryBytes();
+    for (const Plugin& p : plugins) {
+        inScope += p.level >= 0;
+        scanned += p.scanned;
+        cached += p.cached;
+        stoppedEarly += p.stoppedEarly;
     }
-
-    // Whole file range
-    f.seekg(0, std::ios::end);
-    const auto file_end = static_cast<std::uint64_t>(f.tellg());
-    f.seekg(0, std::ios::beg);
-
-    // First thing is the TES4 record (not a GRUP) - parse it like any record:
-    // process_range() will handle it naturally because it treats both records and groups.
-    process_range(tesfile, f, file_end, fn);
+    logger::info(std::format("resolved {} of {} requested edids; searched {} of {} active plugins ({} in scope, {} from cache, {} stopped early, {} reader) in {} ms",
+        resolved, storage.size(), scanned, plugins.size(), inScope, cached, stoppedEarly, source.name(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(resolvedAt - start).count()));
+    logger::info(std::format("scoped EDID index: {} KB (nested unordered_map<std::string> layout would be ~{} KB)",
+        tableBytes / 1024, nestedMapBytes / 1024));
+    logger::info(std::format("armor catalog: {} armors, {} addons, {} omods, {} races; {} KB; {} plugins from cache; {} ms",
+        CATALOG.armo.formID.size(), CATALOG.arma.formID.size(), CATALOG.omod.formID.size(), CATALOG.race.formID.size(),
+        CATALOG.memoryBytes() / 1024, catalogHits.load(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - resolvedAt).count()));
 }
 
-void ArmorIndex::indexAllFormsByTypeAndEdid() {
-    auto* dh = RE::TESDataHandler::GetSingleton();
-    int count = 0;
-
-    auto fn = [&count](RE::ENUM_FORM_ID formtype, const std::string& edid, uint32_t formid) {
-        if (!FORMS_BY_EDID_BY_TYPE[formtype].contains(edid)) {
-            //logger::trace(std::format("saw form {:#010x} with type {:#06x} and edid {}", formid, (uint32_t) formtype, edid));
-            FORMS_BY_EDID_BY_TYPE[formtype][edid] = formid;
-            count++;
-        }
-        return true;
-    };
-    
-    // full plugins (masters + ESPs)
-    for (auto* f : dh->compiledFileCollection.files) {
-        if (f && f->IsActive())
-            scanFormsInFile(f, fn);
+void ArmorIndex::benchmarkEdidScan(const std::filesystem::path& dir) {
+    std::vector<std::string> plugins;
+    for (const char* ext : { ".esm", ".esp", ".esl" }) {
+        auto found = scandir(dir, ext, false);
+        plugins.insert(plugins.end(), found.begin(), found.end());
     }
-    // light plugins (ESLs)
-    for (auto* f : dh->compiledFileCollection.smallFiles) {
-        if (f && f->IsActive())
-            scanFormsInFile(f, fn);
+    logger::info(std::format("benchmarking EDID scan over {} plugins in {}", plugins.size(), dir.string()));
+
+    struct Totals { uint64_t edids{ 0 }; uint64_t checksum{ 0 }; double ms{ 0 }; };
+    uint64_t bytes = 0, records = 0, compressedRecords = 0, compressedBytes = 0;
+    Totals mappedTotals, fullInflateTotals, streamTotals;
+
+    for (const auto& plugin : plugins) {
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(plugin, ec);
+        if (ec) continue;
+        bytes += size;
+
+        // checksum keeps the work observable and lets us confirm both readers agree
+        auto run = [&](Totals& t, auto&& scan) {
+            auto fn = [&t](uint32_t sig, std::string_view edid, uint32_t localID) {
+                t.edids++;
+                t.checksum += (uint64_t)sig * 31 + edid.size() * 17 + localID;
+                return true;
+            };
+            auto start = std::chrono::steady_clock::now();
+            scan(fn);
+            t.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        run(mappedTotals, [&](auto& fn) {
+            MappedFile mapped(plugin);
+            if (mapped.ok()) scan_mapped(mapped.bytes(), fn);
+        });
+        run(fullInflateTotals, [&](auto& fn) {
+            MappedFile mapped(plugin);
+            if (mapped.ok()) scan_mapped<InflateMode::Full>(mapped.bytes(), fn);
+        });
+        run(streamTotals, [&](auto& fn) { scan_stream(plugin, fn); });
+
+        // How much of the indexed record set is compressed, i.e. how much the inflate strategy matters.
+        MappedFile mapped(plugin);
+        if (mapped.ok()) {
+            auto count = [&](const RecordHeader& rh, std::span<const uint8_t> payload) {
+                records++;
+                if (rh.flags & RECORD_FLAG_COMPRESSED) {
+                    compressedRecords++;
+                    if (payload.size() >= 4) compressedBytes += rd_le32(payload.data());
+                }
+                return true;
+            };
+            walk_records(mapped.bytes(), count);
+        }
     }
 
-    logger::info(std::format("scanned active plugins and saw {} compatible forms.", count));
+    // Each reader runs once, mapped first, so on a cold page cache the mapped reader pays for
+    // bringing the plugins in and the others don't. Only its numbers from a warm cache compare.
+    const double mb = bytes / (1024.0 * 1024.0);
+    auto report = [&](const char* name, const Totals& t) {
+        const double secs = t.ms / 1000.0;
+        logger::info(std::format("  {:>20}: {:.1f} ms, {:.1f} MB/s, {:.0f} edids/s, {} edids (checksum {:#018x})",
+            name, t.ms, secs > 0 ? mb / secs : 0.0, secs > 0 ? t.edids / secs : 0.0, t.edids, t.checksum));
+    };
+    logger::info(std::format("  {} records in indexed groups, {} compressed ({} KB inflated size)",
+        records, compressedRecords, compressedBytes / 1024));
+    report("mapped", mappedTotals);
+    report("mapped, full inflate", fullInflateTotals);
+    report("stream", streamTotals);
+    if (mappedTotals.edids != streamTotals.edids || mappedTotals.checksum != streamTotals.checksum
+        || mappedTotals.edids != fullInflateTotals.edids || mappedTotals.checksum != fullInflateTotals.checksum)
+        logger::error("BUG: EDID readers disagree");
 }
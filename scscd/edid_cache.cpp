@@ -0,0 +1,222 @@
+#include "edid_cache.h"
+#include "edid_similarity.h"
+#include "mapped_file.h"
+#include "plugin_format.h"
+#include <fstream>
+#include <unordered_set>
+
+static constexpr uint32_t CACHE_MAGIC = FOURCC('S', 'E', 'D', 'C');
+// Bump whenever the file layout or what the scanner records changes.
+static constexpr uint32_t CACHE_VERSION = 3;
+
+// Large enough for any sane TES4 record; masters lists are the only thing that makes them grow.
+static constexpr uint32_t MAX_HEADER_HASH_BYTES = 64 * 1024;
+
+bool PluginFingerprint::of(const std::filesystem::path& path, PluginFingerprint& out)
+{
+    std::error_code ec;
+    out.size = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+    out.mtime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+    if (ec) return false;
+
+    std::ifstream f(path, std::ios::binary);
+    char rh[24];
+    if (!f.read(rh, sizeof(rh))) return false;
+    uint32_t dataSize;
+    std::memcpy(&dataSize, rh + 4, sizeof(dataSize));
+    std::string header(rh, sizeof(rh));
+    header.resize(sizeof(rh) + std::min(dataSize, MAX_HEADER_HASH_BYTES));
+    f.read(header.data() + sizeof(rh), header.size() - sizeof(rh));
+    header.resize(sizeof(rh) + (size_t)f.gcount());
+    out.headerHash = fnv1a64(header);
+    return true;
+}
+
+namespace {
+    // Bounds-checked cursor over the mapped cache file.
+    struct Reader {
+        std::span<const uint8_t> buf;
+        size_t off{ 0 };
+
+        template <class T>
+        bool get(T& v) {
+            if (buf.size() - off < sizeof(T)) return false;
+            std::memcpy(&v, buf.data() + off, sizeof(T));
+            off += sizeof(T);
+            return true;
+        }
+        bool bytes(void* dst, size_t n) {
+            if (buf.size() - off < n) return false;
+            if (n) std::memcpy(dst, buf.data() + off, n);
+            off += n;
+            return true;
+        }
+    };
+
+    template <class T>
+    void put(std::ofstream& f, const T& v) {
+        f.write(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    // Catalog columns are plain arrays: a u32 count, then the elements as they are in memory.
+    template <class T>
+    bool get_column(Reader& r, std::vector<T>& column) {
+        uint32_t n = 0;
+        if (!r.get(n) || (r.buf.size() - r.off) / sizeof(T) < n) return false;
+        column.resize(n);
+        return r.bytes(column.data(), n * sizeof(T));
+    }
+
+    template <class T>
+    void put_column(std::ofstream& f, const std::vector<T>& column) {
+        put(f, (uint32_t)column.size());
+        f.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+    }
+
+    bool get_catalog(Reader& r, RecordCatalog& c) {
+        bool ok = true;
+        c.forEachColumn([&](auto& column) { ok = ok && get_column(r, column); });
+        return ok && c.consistent();
+    }
+
+    void put_catalog(std::ofstream& f, const RecordCatalog& c) {
+        c.forEachColumn([&](const auto& column) { put_column(f, column); });
+    }
+}
+
+bool EdidCache::load(const std::filesystem::path& path)
+{
+    plugins.clear();
+    MappedFile mapped(path);
+    if (!mapped.ok()) {
+        logger::debug(std::format("no EDID cache at {}", path.string()));
+        return false;
+    }
+
+    Reader r{ mapped.bytes() };
+    uint32_t magic = 0, version = 0, count = 0;
+    if (!r.get(magic) || !r.get(version) || !r.get(count) || magic != CACHE_MAGIC || version != CACHE_VERSION) {
+        logger::info(std::format("EDID cache {} is from another version; it will be rebuilt", path.string()));
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        PluginEdids p;
+        uint16_t nameLen = 0;
+        uint32_t entryCount = 0, namesLen = 0;
+        if (!r.get(nameLen)) break;
+        p.filename.resize(nameLen);
+        if (!r.bytes(p.filename.data(), nameLen)
+            || !r.get(p.fingerprint.size) || !r.get(p.fingerprint.mtime) || !r.get(p.fingerprint.headerHash)
+            || !r.get(entryCount) || !r.get(namesLen)) break;
+
+        // 16 bytes per entry on disk; reject counts the file can't possibly hold before allocating.
+        if ((r.buf.size() - r.off) / 16 < entryCount) break;
+        p.entries.resize(entryCount);
+        bool ok = true;
+        for (auto& e : p.entries) {
+            uint32_t formtype = 0;
+            ok = r.get(formtype) && r.get(e.localID) && r.get(e.offset) && r.get(e.length)
+                && (uint64_t)e.offset + e.length <= namesLen;
+            if (!ok) break;
+            e.formtype = static_cast<RE::ENUM_FORM_ID>(formtype);
+        }
+        if (!ok) break;
+        p.names.resize(namesLen);
+        if (!r.bytes(p.names.data(), namesLen)) break;
+        if (!get_catalog(r, p.catalog)) break;
+
+        plugins.emplace(p.filename, std::move(p));
+    }
+
+    if (plugins.size() != count) {
+        logger::warn(std::format("EDID cache {} is damaged; {} of {} plugins could be read", path.string(), plugins.size(), count));
+    }
+    return true;
+}
+
+bool EdidCache::save(const std::filesystem::path& path, const std::vector<PluginEdids>& tables) const
+{
+    // Tables loaded for plugins that aren't active this session are kept for as long as their
+    // files are on disk and unchanged, so disabling a plugin for a while doesn't cost a rescan.
+    std::unordered_set<std::string_view> active;
+    for (const PluginEdids& p : tables) active.insert(p.filename);
+    std::vector<const PluginEdids*> kept;
+    for (const auto& [filename, p] : plugins) {
+        PluginFingerprint now;
+        if (!active.contains(filename) && PluginFingerprint::of(DataPath(filename), now) && now == p.fingerprint)
+            kept.push_back(&p);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // Write beside the real file and swap it in, so a crash mid-write can't leave a torn cache.
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) {
+            logger::warn(std::format("could not write EDID cache {}", tmp.string()));
+            return false;
+        }
+        put(f, CACHE_MAGIC);
+        put(f, CACHE_VERSION);
+        put(f, (uint32_t)(tables.size() + kept.size()));
+        auto write = [&f](const PluginEdids& p) {
+            put(f, (uint16_t)p.filename.size());
+            f.write(p.filename.data(), p.filename.size());
+            put(f, p.fingerprint.size);
+            put(f, p.fingerprint.mtime);
+            put(f, p.fingerprint.headerHash);
+            put(f, (uint32_t)p.entries.size());
+            put(f, (uint32_t)p.names.size());
+            for (const auto& e : p.entries) {
+                put(f, (uint32_t)e.formtype);
+                put(f, e.localID);
+                put(f, e.offset);
+                put(f, e.length);
+            }
+            f.write(p.names.data(), p.names.size());
+            put_catalog(f, p.catalog);
+        };
+        for (const PluginEdids& p : tables) write(p);
+        for (const PluginEdids* p : kept) write(*p);
+        if (!f) {
+            logger::warn(std::format("could not write EDID cache {}", tmp.string()));
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        logger::warn(std::format("could not replace EDID cache {}: {}", path.string(), ec.message()));
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool EdidCache::take(PluginEdids& out)
+{
+    auto it = plugins.find(out.filename);
+    if (it == plugins.end() || !(it->second.fingerprint == out.fingerprint))
+        return false;
+    out.entries = std::move(it->second.entries);
+    out.names = std::move(it->second.names);
+    out.catalog = std::move(it->second.catalog);
+    return true;
+}
+
+bool EdidCache::covers(const PluginEdids& p) const
+{
+    auto it = plugins.find(p.filename);
+    return it != plugins.end() && it->second.fingerprint == p.fingerprint;
+}
+
+void EdidCache::insert(PluginEdids&& p)
+{
+    std::string filename = p.filename;
+    plugins.insert_or_assign(std::move(filename), std::move(p));
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "scscd.h"
+#include "plugin_catalog.h"
+#include "thread_pool.h"
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Identifies one version of a plugin file on disk. If any field differs from what was cached,
+// the plugin is rescanned.
+struct PluginFingerprint {
+    uint64_t size{ 0 };
+    int64_t mtime{ 0 };
+    uint64_t headerHash{ 0 }; // FNV-1a of the TES4 record, which carries the master list and record count
+
+    bool operator==(const PluginFingerprint&) const = default;
+
+    static bool of(const std::filesystem::path& path, PluginFingerprint& out);
+};
+
+// EDIDs discovered in one plugin, in record order. Form IDs are the plugin-local IDs as stored
+// in the file, so a table stays valid no matter where the plugin sits in the load order; the
+// runtime ID is composed when the table is merged into the index. Names live in one buffer per
+// plugin so that a scan doesn't allocate a string per record.
+struct PluginEdids {
+    struct Entry {
+        RE::ENUM_FORM_ID formtype;
+        uint32_t localID;
+        uint32_t offset;
+        uint32_t length;
+    };
+    RE::TESFile* file{ nullptr };
+    std::string filename; // lowercase
+    PluginFingerprint fingerprint;
+    std::vector<Entry> entries;
+    std::string names;
+    // Armor, addon, omod and race records, captured in the same scan. Like the entries,
+    // form IDs are as stored in the file.
+    RecordCatalog catalog;
+
+    std::string_view edid(const Entry& e) const { return std::string_view(names).substr(e.offset, e.length); }
+};
+
+// Where the cache lives, relative to the Data folder.
+inline constexpr const char* EDID_CACHE_FILE = "F4SE\\Plugins\\scscd\\cache\\edid_index.bin";
+
+// Binary cache of PluginEdids tables (catalogs included), one per plugin, kept under the scscd data folder between
+// launches. Nothing in it depends on load order, so plugins can be added, removed or reordered
+// freely; only plugins whose fingerprint changed need to be scanned again.
+class EdidCache {
+    std::unordered_map<std::string, PluginEdids> plugins;
+
+public:
+    // Reads the cache file. A missing, truncated or outdated file just leaves the cache empty.
+    bool load(const std::filesystem::path& path);
+
+    // Replaces the cache file with the given tables, plus the loaded tables of plugins that are
+    // not among them but whose files haven't changed.
+    bool save(const std::filesystem::path& path, const std::vector<PluginEdids>& tables) const;
+
+    // If a table for out.filename with a matching fingerprint was loaded, moves its contents
+    // into `out` and returns true. Safe to call concurrently for distinct filenames.
+    bool take(PluginEdids& out);
+
+    // True if take() would succeed for p. Safe to call concurrently.
+    bool covers(const PluginEdids& p) const;
+
+    // Adds (or replaces) a table, as if it had been loaded.
+    void insert(PluginEdids&& p);
+
+    size_t size() const { return plugins.size(); }
+};
+
+// Scans each table's plugin (found in the Data folder by its filename) into its entries and
+// catalog, all plugins at once. Tables must start out empty. Returns how many AsyncReader workers
+// the scan ran on, 0 if there was nothing to scan.
+size_t ScanPluginEdids(std::span<PluginEdids* const> tables, size_t workers = worker_count());
@@ -0,0 +1,86 @@
+#include "scscd.h"
+#include "edid_table.h"
+
+void EdidTable::reserve(size_t edids, size_t nameBytes)
+{
+    size_t capacity = 16;
+    while (capacity < edids * 2) capacity <<= 1;
+    if (capacity > slots.size()) grow(capacity);
+    pool.reserve(nameBytes);
+    ids.reserve(edids);
+}
+
+// Index of the slot holding `edid`, or of the empty slot where it would go.
+size_t EdidTable::probe(uint32_t hash, std::string_view edid) const
+{
+    const size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Slot& s = slots[i];
+        if (s.nameLength == 0) return i;
+        if (s.hash == hash && edid_equals(std::string_view(pool).substr(s.nameOffset, s.nameLength), edid)) return i;
+    }
+}
+
+void EdidTable::grow(size_t capacity)
+{
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(capacity, Slot{});
+    const size_t mask = capacity - 1;
+    for (const Slot& s : old) {
+        if (s.nameLength == 0) continue;
+        size_t i = s.hash & mask;
+        while (slots[i].nameLength != 0) i = (i + 1) & mask;
+        slots[i] = s;
+    }
+}
+
+bool EdidTable::insert(RE::ENUM_FORM_ID type, std::string_view edid, uint32_t formID)
+{
+    const uint32_t bit = FormTypeBit(type);
+    if (!bit || edid.empty()) return false;
+    if ((count + 1) * 2 > slots.size()) grow(std::max<size_t>(16, slots.size() * 2));
+
+    const uint32_t hash = edid_hash(edid);
+    Slot& s = slots[probe(hash, edid)];
+    if (s.nameLength == 0) {
+        s = { hash, (uint32_t)pool.size(), (uint32_t)edid.size(), bit, (uint32_t)ids.size() };
+        pool.append(edid);
+        ids.push_back(formID);
+        count++;
+        formCount++;
+        return true;
+    }
+    if (s.types & bit) return false;
+
+    // Another type under a name we already have. Rare, so the slot's IDs just move to the end
+    // with the new one slotted into place, and the old ones are abandoned.
+    const uint32_t before = std::popcount(s.types & (bit - 1));
+    const uint32_t n = std::popcount(s.types);
+    const uint32_t offset = (uint32_t)ids.size();
+    for (uint32_t k = 0; k < n + 1; k++) {
+        if (k < before) ids.push_back(ids[s.idsOffset + k]);
+        else if (k == before) ids.push_back(formID);
+        else ids.push_back(ids[s.idsOffset + k - 1]);
+    }
+    s.types |= bit;
+    s.idsOffset = offset;
+    formCount++;
+    return true;
+}
+
+EdidTable::Match EdidTable::find(std::string_view edid) const
+{
+    if (slots.empty() || edid.empty()) return {};
+    const Slot& s = slots[probe(edid_hash(edid), edid)];
+    if (s.nameLength == 0) return {};
+    return { s.types, ids.data() + s.idsOffset };
+}
+
+void EdidTable::clear()
+{
+    slots.clear();
+    pool.clear();
+    ids.clear();
+    count = 0;
+    formCount = 0;
+}
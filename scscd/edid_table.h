@@ -0,0 +1,115 @@
+#pragma once
+
+#include "_fallout.h"
+#include "plugin_format.h"
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One bit for each form type whose editor IDs we index, so that sets of them can be passed
+// around as a mask. Types we don't index map to 0. Matches RecordTypeBit() in plugin_format.h.
+static uint32_t FormTypeBit(RE::ENUM_FORM_ID type) {
+    switch (type) {
+    case RE::ENUM_FORM_ID::kARMO: return 1u << 0;
+    case RE::ENUM_FORM_ID::kARMA: return 1u << 1;
+    case RE::ENUM_FORM_ID::kOMOD: return 1u << 2;
+    case RE::ENUM_FORM_ID::kNPC_: return 1u << 3;
+    case RE::ENUM_FORM_ID::kRACE: return 1u << 4;
+    case RE::ENUM_FORM_ID::kFACT: return 1u << 5;
+    case RE::ENUM_FORM_ID::kCLAS: return 1u << 6;
+    default:                      return 0;
+    }
+}
+static constexpr uint32_t ALL_FORM_TYPE_BITS = ALL_RECORD_TYPE_BITS;
+
+// Editor IDs are case-insensitive in the engine, so they are hashed and compared that way here.
+static inline uint32_t edid_hash(std::string_view s) {
+    uint32_t h = 2166136261u; // FNV-1a over ASCII-lowercased bytes
+    for (unsigned char c : s) {
+        if (c >= 'A' && c <= 'Z') c |= 32;
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h;
+}
+static inline bool edid_equals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        unsigned char ca = static_cast<unsigned char>(a[i]);
+        unsigned char cb = static_cast<unsigned char>(b[i]);
+        if (ca >= 'A' && ca <= 'Z') ca |= 32;
+        if (cb >= 'A' && cb <= 'Z') cb |= 32;
+        if (ca != cb) return false;
+    }
+    return true;
+}
+// For keying standard containers by editor ID.
+struct EdidHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return edid_hash(s); }
+};
+struct EdidEqual {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const { return edid_equals(a, b); }
+};
+
+// Editor ID -> form ID table for the form types in FormTypeBit. Every distinct editor ID is
+// stored once, in a single character pool, and owns one slot of an open-addressing table; the
+// slot records which types have a form by that name and where their form IDs are. A lookup is
+// one hash of the caller's string_view and one probe sequence, and finds every type at once.
+//
+// Nothing is ever removed. Not thread-safe for writes.
+class EdidTable {
+    struct Slot {
+        uint32_t hash;
+        uint32_t nameOffset;
+        uint32_t nameLength; // 0 = empty slot
+        uint32_t types;      // FormTypeBit mask
+        uint32_t idsOffset;  // form IDs for each bit in `types`, lowest bit first
+    };
+
+    std::vector<Slot> slots; // power-of-two size, at most half full
+    std::string pool;
+    std::vector<uint32_t> ids;
+    size_t count{ 0 };
+    size_t formCount{ 0 };
+
+    size_t probe(uint32_t hash, std::string_view edid) const;
+    void grow(size_t capacity);
+
+public:
+    // Result of find(): every form that goes by the looked-up name, one per type.
+    struct Match {
+        uint32_t types{ 0 };
+        const uint32_t* ids{ nullptr };
+
+        explicit operator bool() const { return types != 0; }
+        bool has(RE::ENUM_FORM_ID type) const { return (types & FormTypeBit(type)) != 0; }
+        // 0 if there is no form of that type
+        uint32_t formID(RE::ENUM_FORM_ID type) const {
+            const uint32_t bit = FormTypeBit(type);
+            if (!(types & bit)) return 0;
+            return ids[std::popcount(types & (bit - 1))];
+        }
+    };
+
+    // Sizes the table for `edids` distinct names totalling `nameBytes` characters.
+    void reserve(size_t edids, size_t nameBytes);
+
+    // Adds a form. If a form of the same type already has this name (in any case), the table is
+    // left unchanged and false is returned, so the first form inserted wins.
+    bool insert(RE::ENUM_FORM_ID type, std::string_view edid, uint32_t formID);
+
+    Match find(std::string_view edid) const;
+    uint32_t find(RE::ENUM_FORM_ID type, std::string_view edid) const { return find(edid).formID(type); }
+
+    size_t size() const { return count; }
+    size_t forms() const { return formCount; }
+    size_t memoryBytes() const {
+        return slots.capacity() * sizeof(Slot) + pool.capacity() + ids.capacity() * sizeof(uint32_t);
+    }
+
+    void clear();
+};
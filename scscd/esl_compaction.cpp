@@ -0,0 +1,26 @@
+#include "esl_compaction.h"
+#include <algorithm>
+
+EslCompaction::EslCompaction(std::vector<uint32_t> ids)
+{
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    constexpr size_t SLOTS = LAST_OBJECT_ID - FIRST_OBJECT_ID + 1;
+    if (ids.size() > SLOTS) {
+        overflow_ = true;
+        return;
+    }
+
+    byCompacted_.assign(SLOTS, 0);
+    for (uint32_t id : ids) {
+        if (id >= FIRST_OBJECT_ID && id <= LAST_OBJECT_ID)
+            byCompacted_[id - FIRST_OBJECT_ID] = id;
+    }
+    size_t next = 0;
+    for (uint32_t id : ids) {
+        if (id >= FIRST_OBJECT_ID && id <= LAST_OBJECT_ID) continue;
+        while (byCompacted_[next] != 0) next++; // can't run off the end: ids.size() <= SLOTS
+        byCompacted_[next] = id;
+        moved_++;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Renumbering that xEdit's "Compact FormIDs for ESL" applies to a plugin, worked out from the
+// uncompacted plugin itself. The plugin's own records (not overrides of its masters' records) are
+// taken in ascending form ID order. Records whose object IDs are already in the ESL range keep
+// them. Every other record gets the lowest free ID from the bottom of the range. Because the
+// renumbering is deterministic, a CSV author's compacted IDs can be mapped back to the IDs in the
+// original plugin.
+//
+// This is a reconstruction of what xEdit does, not something read from it. `scscd-scan
+// --verify-esl` checks it against a plugin and a copy of it that xEdit compacted, and the CSV
+// scanner warns when a translated ID lands on a form of a type the line didn't expect.
+class EslCompaction {
+public:
+    static constexpr uint32_t FIRST_OBJECT_ID = 0x800;
+    static constexpr uint32_t LAST_OBJECT_ID = 0xFFF;
+
+    EslCompaction() {}
+
+    // ids: object IDs (low 24 bits of the form ID) of every record the plugin adds, in any order.
+    explicit EslCompaction(std::vector<uint32_t> ids);
+
+    // Object ID in the uncompacted plugin of the record that compaction numbered `compactedID`
+    // (only its low 12 bits are used), or 0 if compaction gives no record that ID.
+    uint32_t original(uint32_t compactedID) const {
+        const uint32_t id = compactedID & LAST_OBJECT_ID;
+        if (id < FIRST_OBJECT_ID) return 0;
+        return byCompacted_.empty() ? 0 : byCompacted_[id - FIRST_OBJECT_ID];
+    }
+
+    // Number of records that compaction renumbers.
+    size_t moved() const { return moved_; }
+
+    // True if the plugin adds more records than an ESL can hold. In that case it can't be
+    // compacted, and original() resolves nothing.
+    bool overflow() const { return overflow_; }
+
+private:
+    std::vector<uint32_t> byCompacted_; // original object ID, indexed by compacted ID - FIRST_OBJECT_ID
+    size_t moved_{ 0 };
+    bool overflow_{ false };
+};
@@ -1,6 +1,11 @@
 #include "scscd.h"
 #include "csv_scanner.h"
-#include "benchmark.h"
+#include "matswap_validity_report.h"
+#include "omod_index.h"
+#include "plugin_reader.h"
+#include "plugin_prescan.h"
+#include "plugin_registry.h"
+#include "task_graph.h"
 
 #include "F4SE/API.h"
 #include "F4SE/Interfaces.h"
@@ -44,6 +49,14 @@ extern "C" __declspec(dllexport) bool F4SEPlugin_Load(const F4SE::LoadInterface*
 			return false;
 		}
 
+		detail::textureIndex.useRecordHashes(SAMPLER_CONFIG.textureIndexFromRecords);
+
+		// Get a head start on reading plugins and archives while the game loads them. Only files
+		// are touched, read-only and shared; the game itself is not looked at before data-ready.
+		if (SAMPLER_CONFIG.prescanPlugins) {
+			PluginPrescan::Instance().Start(SAMPLER_CONFIG.scopedEdidLookup);
+		}
+
 		const F4SE::MessagingInterface* msg = F4SE::GetMessagingInterface();
 		if (!msg) {
 			logger::error("SCSCD: Init failed! Messaging interface is not available.");
@@ -69,17 +82,65 @@ extern "C" __declspec(dllexport) bool F4SEPlugin_Load(const F4SE::LoadInterface*
 				if (/* OG: kGameLoaded */ msg->type == F4SE::MessagingInterface::kGameLoaded ||
 					/* NG: kGameDataReady, false before data, true after data */ (bool)msg->data) {
 					logger::info("SCSCD indexing forms");
-					// might be tempting to scan earlier on but it's safer to wait for game data
-					// because we don't know if the game is might be loading plugins in a separate
-					// thread, and we must not risk contesting an open file.
-					ArmorIndex::indexAllFormsByTypeAndEdid();
-					benchmark("SCSCD scanning CSV files", []{
-						std::unordered_map<std::string, Taxon> taxonomy;
+					// Everything below names plugins and composes runtime form IDs through the registry.
+					PluginRegistry::Instance().Build();
+					// The engine's forms are only safe to look at from here on. Both index builders
+					// pick up whatever the pre-scan (if enabled) has already read from the files.
+					// The stages below only wait on what they read; the game thread waits for all of them.
+					std::unordered_map<std::string, Taxon> taxonomy;
+					TaskGraph startup;
+					auto indexEdids = [] {
+						if (SAMPLER_CONFIG.scopedEdidLookup) {
+							// only look for the EDIDs the CSV files actually use, in the plugins they name
+							EdidRequests requests;
+							if (!PluginPrescan::Instance().TakeRequests(requests)) {
+								collect_occupation_edids(DataPath("F4SE\\Plugins\\scscd\\occupation"), requests);
+								collect_tuple_edids(DataPath("F4SE\\Plugins\\scscd\\clothing"), requests);
+								collect_exclusion_edids(DataPath("F4SE\\Plugins\\scscd\\exclusions"), requests);
+							}
+							ArmorIndex::indexRequestedFormsByPluginAndEdid(requests);
+						}
+						else {
+							ArmorIndex::indexAllFormsByTypeAndEdid();
+						}
+					};
+					// The engine's plugin reader only works on this thread (see EngineRecordSource), so when
+					// SCSCD_RECORD_SOURCE=engine asks for it, the EDID index is built here before the graph
+					// starts and its stage has nothing left to do.
+					const bool edidsHere = SAMPLER_CONFIG.scopedEdidLookup && EngineRecordSourceRequested();
+					if (edidsHere) indexEdids();
+					auto edids = startup.add("EDID index", [&] { if (!edidsHere) indexEdids(); });
+					// Only files; usually already built by the pre-scan, in which case this just waits for it.
+					startup.add("texture index", [] { detail::textureIndex.build(); });
+					auto taxa = startup.add("taxonomy", [&] {
 						scan_taxonomies_csv(DataPath("F4SE\\Plugins\\scscd\\taxonomy"), taxonomy);
+					});
+					// Built from the plugin catalog, so it must follow the EDID index.
+					auto omods = startup.add("OMOD index", [] { OmodIndex::Instance().BuildFromCatalog(ArmorIndex::catalog()); }, { edids });
+					startup.add("occupations", [] {
 						scan_occupations_csv(DataPath("F4SE\\Plugins\\scscd\\occupation"), OCCUPATIONS);
-						scan_tuples_csv(DataPath("F4SE\\Plugins\\scscd\\clothing"), false, ARMORS, taxonomy);
+					}, { edids });
+					// Only queues the OMODs it registers; they are validated once the graph is done.
+					startup.add("clothing", [&] {
+						scan_tuples_csv(DataPath("F4SE\\Plugins\\scscd\\clothing"), false, ARMORS, taxonomy, SAMPLER_CONFIG.discoverOmods);
+					}, { edids, taxa, omods });
+					startup.add("exclusions", [] {
 						scan_exclusions_csv(DataPath("F4SE\\Plugins\\scscd\\exclusions"), ActorLoadWatcher::exclusionList);
-					});
+					}, { edids });
+					startup.run(SAMPLER_CONFIG.parallelStartup ? worker_count() : 1);
+					// Reads materials and probes the texture index built above. In the background, NPCs
+					// only get OMODs that have passed so far, and more become available as they do.
+					ARMORS.validateOmods(SAMPLER_CONFIG.validateOmodsInBackground, SAMPLER_CONFIG.engineMaterialReads);
+
+					// Developer aid: set SCSCD_BENCHMARK_PLUGINS to a directory of plugins to compare EDID readers.
+					if (const char* dir = std::getenv("SCSCD_BENCHMARK_PLUGINS"); dir && *dir) {
+						ArmorIndex::benchmarkEdidScan(dir);
+					}
+					// Developer aid: set SCSCD_COMPARE_RECORD_SOURCES to time the engine's plugin reader against ours
+					// on the active plugins and check that they agree; "probe" also runs the engine's trace-only walk.
+					if (const char* mode = std::getenv("SCSCD_COMPARE_RECORD_SOURCES"); mode && *mode) {
+						CompareRecordSources(std::string_view(mode) == "probe");
+					}
 				}
 				// Register listener here so we can pre-empt any actors which are loaded
 				// as part of savegame restore.
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file on disk. The file is opened with full sharing, so it is safe
+// to hold a mapping while the game (or anything else) has the same plugin or archive open.
+//
+// Nothing is copied: bytes() points straight into the page cache, and pages are only faulted
+// in as they are touched. That matters for plugins, where we hop from header to header and
+// never look at most of the payload.
+class MappedFile {
+    const std::uint8_t* data_{ nullptr };
+    std::size_t size_{ 0 };
+#ifdef _WIN32
+    HANDLE file_{ INVALID_HANDLE_VALUE };
+    HANDLE mapping_{ nullptr };
+#endif
+
+public:
+    MappedFile() {}
+    explicit MappedFile(const std::filesystem::path& path) { open(path); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& o) noexcept { *this = std::move(o); }
+    MappedFile& operator=(MappedFile&& o) noexcept {
+        if (this != &o) {
+            close();
+            data_ = std::exchange(o.data_, nullptr);
+            size_ = std::exchange(o.size_, 0);
+#ifdef _WIN32
+            file_ = std::exchange(o.file_, INVALID_HANDLE_VALUE);
+            mapping_ = std::exchange(o.mapping_, nullptr);
+#endif
+        }
+        return *this;
+    }
+
+    // Returns false if the file could not be opened or mapped. Empty files cannot be
+    // mapped on Windows, so they report false as well; callers treat that like any
+    // other unreadable file.
+    bool open(const std::filesystem::path& path) {
+        close();
+#ifdef _WIN32
+        file_ = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER sz{};
+        if (!::GetFileSizeEx(file_, &sz) || sz.QuadPart == 0) { close(); return false; }
+
+        mapping_ = ::CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) { close(); return false; }
+
+        data_ = static_cast<const std::uint8_t*>(::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (!data_) { close(); return false; }
+        size_ = static_cast<std::size_t>(sz.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st {};
+        if (::fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+
+        void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd); // the mapping keeps its own reference to the file
+        if (p == MAP_FAILED) return false;
+
+        data_ = static_cast<const std::uint8_t*>(p);
+        size_ = static_cast<std::size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data_) ::UnmapViewOfFile(data_);
+        if (mapping_) ::CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) ::CloseHandle(file_);
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_) ::munmap(const_cast<std::uint8_t*>(data_), size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    bool ok() const { return data_ != nullptr; }
+    std::size_t size() const { return size_; }
+    std::span<const std::uint8_t> bytes() const { return { data_, size_ }; }
+};
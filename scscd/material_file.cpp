@@ -0,0 +1,120 @@
+#include "material_file.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+// Layout, shared by both kinds: 4CC, version, tile flags, UV offset and scale, alpha, blend state,
+// then a run of single-byte flags up to the refraction power. The block after that changed with
+// version 10, and version 6 added the mask writes byte. The texture slots follow, each a uint32
+// length (counting its NUL) and the bytes.
+static size_t header_size(uint32_t version)
+{
+    size_t size = 4 + 4 + 4 + 16 + 4;  // magic, version, tile flags, UV offset/scale, alpha
+    size += 1 + 4 + 4;                  // alpha blend mode
+    size += 1 + 1;                      // alpha test ref, alpha test
+    size += 8;                          // z write, z test, SSR, wetness SSR, decal, two sided, decal no fade, non occluder
+    size += 1 + 1 + 4;                  // refraction, refraction falloff, refraction power
+    size += version < 10 ? 1 + 4 : 1;   // environment mapping and its mask scale, or depth bias
+    size += 1;                          // grayscale to palette color
+    if (version >= 6) size += 1;        // mask writes
+    return size;
+}
+
+static size_t texture_slots(bool effect, uint32_t version)
+{
+    if (effect) {
+        // base, grayscale, envmap, normal, envmap mask; then specular, lighting, glow
+        return version >= 11 ? 8 : 5;
+    }
+    // diffuse, normal, smooth spec, greyscale, then either envmap, glow, inner layer, wrinkles,
+    // displacement (up to version 2) or glow, wrinkles, specular, lighting, flow, and from version 17
+    // distance field alpha
+    return version >= 17 ? 10 : 9;
+}
+
+size_t read_material_textures(std::span<const uint8_t> bytes, std::vector<std::string_view>& out)
+{
+    if (bytes.size() < 8) return 0;
+    const bool lit = std::memcmp(bytes.data(), "BGSM", 4) == 0;
+    const bool effect = std::memcmp(bytes.data(), "BGEM", 4) == 0;
+    uint32_t version;
+    std::memcpy(&version, bytes.data() + 4, 4);
+    if ((!lit && !effect) || version == 0 || version > MAX_MATERIAL_VERSION) return 0;
+
+    const size_t before = out.size();
+    size_t pos = header_size(version);
+    const size_t slots = texture_slots(effect, version);
+    for (size_t slot = 0; slot < slots; slot++) {
+        uint32_t len;
+        if (pos + 4 > bytes.size()) {
+            out.resize(before);
+            return 0;
+        }
+        std::memcpy(&len, bytes.data() + pos, 4);
+        pos += 4;
+        if (len > bytes.size() - pos) {
+            out.resize(before);
+            return 0;
+        }
+        std::string_view s(reinterpret_cast<const char*>(bytes.data() + pos), len);
+        pos += len;
+        s = s.substr(0, s.find('\0'));
+        if (!s.empty()) out.push_back(s);
+    }
+    return pos;
+}
+
+std::vector<std::string> scrape_dds_paths(std::span<const uint8_t> bytes)
+{
+    std::vector<std::string> paths;
+    std::string cur;
+
+    auto flush = [&]() {
+        if (cur.size() >= 5) { // "a.dds" minimal-ish
+            // Quick check for ".dds" (case-insensitive)
+            std::string low = cur;
+            std::transform(low.begin(), low.end(), low.begin(), [](unsigned char c) { return std::tolower(c); });
+            if (low.find(".dds") != std::string::npos) {
+                // normalize slashes a bit
+                for (auto& ch : cur) if (ch == '\\') ch = '/';
+                // strip surrounding spaces
+                auto l = cur.find_first_not_of(' ');
+                auto r = cur.find_last_not_of(' ');
+                if (l != std::string::npos && r != std::string::npos) {
+                    paths.emplace_back(cur.substr(l, r - l + 1));
+                }
+            }
+        }
+        cur.clear();
+        };
+
+    // Acceptable filename characters in BGSM/BGEM strings are usually printable ASCII
+    auto is_ok = [](unsigned char c) -> bool {
+        return c >= 32 && c <= 126; // printable
+        };
+
+    for (auto b : bytes) {
+        if (is_ok(b)) {
+            cur.push_back(static_cast<char>(b));
+            // Heuristic guard: avoid runaway extremely long 'strings'
+            if (cur.size() > 512) flush();
+        }
+        else {
+            flush();
+        }
+    }
+    flush();
+
+    // De-dup (case-insensitive)
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> unique;
+    for (auto& p : paths) {
+        std::string key = p;
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (!seen.count(key)) {
+            seen.insert(std::move(key));
+            unique.emplace_back(std::move(p));
+        }
+    }
+    return unique;
+}
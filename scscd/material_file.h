@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Readers for the texture paths named by BGSM (lit) and BGEM (effect) material files. Nothing here
+// depends on the game, so the scscd-scan tool can benchmark them over a folder of materials.
+
+// Newest material version whose layout read_material_textures() knows. Fallout 4 writes 1 and 2;
+// later ones are Fallout 76's, which keep the same layout up to the texture slots.
+inline constexpr uint32_t MAX_MATERIAL_VERSION = 22;
+
+// Decodes a material's header and appends each non-empty texture slot to `out`, in file order, as
+// views into `bytes`. Slots are paths relative to Data/Textures as the material spells them, with
+// whatever slashes and case it used. Nothing past the last texture slot is looked at.
+//
+// Returns the number of bytes read, up to and including the last slot, or 0 if `bytes` isn't a
+// material of a known version or ends early; `out` is left as it was then.
+size_t read_material_textures(std::span<const uint8_t> bytes, std::vector<std::string_view>& out);
+
+// The heuristic read_material_textures() replaced: every run of printable bytes containing ".dds",
+// with '\' turned into '/', trimmed of spaces, and de-duplicated ignoring case. Kept as the
+// fallback for files the reader doesn't know, and so the benchmark can compare the two.
+std::vector<std::string> scrape_dds_paths(std::span<const uint8_t> bytes);
@@ -1,9 +1,15 @@
 #include "scscd.h"
+#include "ba2_archive.h"
+#include "csv_scanner.h"
+#include "material_file.h"
+#include "omod_verdict_cache.h"
 #include "texture_index.h"
 #include <string>
 #include <vector>
-#include <unordered_set>
+#include <unordered_map>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 
 struct SwapPreflightReport
 {
@@ -16,25 +22,93 @@ struct SwapPreflightReport
 namespace detail
 {
     // BSResourceNiBinaryStream is only working for 'Main' BA2s, not for 'Textures' BA2s.
-    // So we have to index the latter ourselves to complete validation.
-    static TextureIndex textureIndex;
+    // So we have to index the latter ourselves to complete validation. The pre-scan builds it
+    // ahead of time, so this must be the one instance in the process.
+    inline TextureIndex textureIndex;
 
-    // Open and test via operator bool()
+    // For the validation log: existence checks answered by the index, materials read, how many of
+    // those needed an engine stream after all, materials whose last launch's reading was reused
+    // instead, and the streams validation would have opened without the index.
+    struct ResourceStats {
+        std::atomic<size_t> probes{ 0 };
+        std::atomic<size_t> opens{ 0 };
+        std::atomic<size_t> reused{ 0 };
+        std::atomic<size_t> engineOpens{ 0 };
+        std::atomic<size_t> legacyOpens{ 0 };
+    };
+    inline ResourceStats resourceStats;
+
+    // What validating one material found: whether it could be read, and the textures it names.
+    struct MaterialCheck {
+        bool found{ false };
+        std::vector<std::string> okTextures;
+        std::vector<std::string> missingTextures;
+    };
+
+    // Verdicts remembered for the rest of the session. A clothing pack's omods tend to share a
+    // handful of material swaps, and those a handful of materials, so each swap, material and
+    // texture is only checked the first time it comes up. Only touched by omod validation, which
+    // runs on one thread.
+    struct ValidationCache {
+        struct Counter {
+            size_t hits{ 0 }, lookups{ 0 };
+        };
+        std::unordered_map<uint32_t, bool> swaps;                 // by BGSMaterialSwap form ID
+        std::unordered_map<std::string, MaterialCheck> materials; // by material path, lowercase with '/'
+        std::unordered_map<uint64_t, bool> textures;              // by TextureIndex::hash() of the path as named
+        Counter swapStats, materialStats, textureStats;
+    };
+    inline ValidationCache validationCache;
+
+    // Loose files and every BA2, general and texture alike, are in the index.
     inline bool ResourceExists(const char* path)
     {
         if (!path || !*path) return false;
+        resourceStats.probes++;
+        return textureIndex.contains(path);
+    }
 
-        // Handles loose files and general BA2s. Does not handle texture BA2s.
-        RE::BSResourceNiBinaryStream s(path);
-        return static_cast<bool>(s) || /* handle texture BA2s -> */textureIndex.contains(path);
+    // Materials are read straight out of the general archives and loose files, without the game's
+    // resource system, so reading one needs neither the game thread nor the engine. Opened the
+    // first time a material is read, after the plugins are loaded, so their archives can be put
+    // in load order.
+    inline GeneralArchives generalArchives;
+    inline std::once_flag generalArchivesOpened;
+
+    inline const GeneralArchives& GetGeneralArchives()
+    {
+        std::call_once(generalArchivesOpened, [] {
+            const PluginRegistry& registry = PluginRegistry::Instance();
+            std::vector<std::string> plugins;
+            for (uint16_t i = 0; i < registry.size(); i++) plugins.push_back(registry[i].filename);
+            std::vector<std::filesystem::path> ba2s;
+            for (auto& ba2 : scandir(GetDataDir(), ".ba2", false)) ba2s.emplace_back(ba2);
+            generalArchives.open(GetDataDir(), ba2_load_order(std::move(ba2s), plugins));
+        });
+        return generalArchives;
     }
 
-    // Read whole file through NiBinaryStream; no std::filesystem, works for BA2.
-    inline bool ReadWholeFile(const char* path, std::vector<std::uint8_t>& out)
+    // Whether a material that is neither loose nor in a general archive is also looked for through
+    // the engine's resource system (bEngineMaterialReads). Set by omod validation before it starts.
+    inline bool engineMaterialReads{ false };
+
+    // Reads a whole file from the loose files and general archives. Only with `engineFallback` is
+    // a file they don't have tried through NiBinaryStream as well, in case the game can see
+    // something our reader can't (an archive version we don't know, say); otherwise it is missing.
+    // `fromArchives`, if given, says which of the two it was.
+    inline bool ReadWholeFile(const char* path, std::vector<std::uint8_t>& out, bool engineFallback, bool* fromArchives = nullptr)
     {
         out.clear();
+        if (fromArchives) *fromArchives = false;
         if (!path || !*path) return false;
 
+        resourceStats.opens++;
+        if (GetGeneralArchives().read(path, out)) {
+            if (fromArchives) *fromArchives = true;
+            return true;
+        }
+        if (!engineFallback) return false;
+        resourceStats.engineOpens++;
         RE::BSResourceNiBinaryStream s(path);
         if (!s) return false;
 
@@ -61,60 +135,146 @@ namespace detail
         return true;
     }
 
-    // Extract ASCII substrings that contain ".dds" (case-insensitive), e.g. "textures\\foo\\bar_d.dds"
-    inline std::vector<std::string> ExtractDDSPaths(const std::vector<std::uint8_t>& bytes)
+    // The textures a material names: its texture slots, or, for a file that isn't a material of a
+    // version the reader knows, whatever looks like a .dds path in it. Each path once, ignoring case,
+    // with '/' for '\'. Only .dds slots are returned, as those are all the scraper ever checked; a
+    // slot naming anything else is logged and doesn't count against the omod.
+    inline std::vector<std::string> ExtractTexturePaths(const char* matPath, const std::vector<std::uint8_t>& bytes)
     {
+        std::vector<std::string_view> slots;
+        if (!read_material_textures(bytes, slots)) {
+            logger::debug(std::format("{} is not a material the reader knows; looking for .dds paths in it instead", matPath));
+            return scrape_dds_paths(bytes);
+        }
         std::vector<std::string> paths;
-        std::string cur;
-
-        auto flush = [&]() {
-            if (cur.size() >= 5) { // "a.dds" minimal-ish
-                // Quick check for ".dds" (case-insensitive)
-                std::string low = cur;
-                std::transform(low.begin(), low.end(), low.begin(), [](unsigned char c) { return std::tolower(c); });
-                if (low.find(".dds") != std::string::npos) {
-                    // normalize slashes a bit
-                    for (auto& ch : cur) if (ch == '\\') ch = '/';
-                    // strip surrounding spaces
-                    auto l = cur.find_first_not_of(' ');
-                    auto r = cur.find_last_not_of(' ');
-                    if (l != std::string::npos && r != std::string::npos) {
-                        paths.emplace_back(cur.substr(l, r - l + 1));
-                    }
-                }
+        std::vector<uint64_t> seen;
+        for (std::string_view slot : slots) {
+            if (!ends_with_icase(std::string(slot), ".dds")) {
+                logger::debug(std::format("{}: not checking texture slot {}, which is not a .dds", matPath, slot));
+                continue;
             }
-            cur.clear();
-            };
-
-        // Acceptable filename characters in BGSM/BGEM strings are usually printable ASCII
-        auto is_ok = [](unsigned char c) -> bool {
-            return c >= 32 && c <= 126; // printable
-            };
-
-        for (auto b : bytes) {
-            if (is_ok(b)) {
-                cur.push_back(static_cast<char>(b));
-                // Heuristic guard: avoid runaway extremely long 'strings'
-                if (cur.size() > 512) flush();
+            const uint64_t key = TextureIndex::hash(slot);
+            if (std::find(seen.begin(), seen.end(), key) != seen.end()) continue;
+            seen.push_back(key);
+            std::string& path = paths.emplace_back(slot);
+            std::replace(path.begin(), path.end(), '\\', '/');
+        }
+        return paths;
+    }
+}
+
+// Logs how many engine stream opens validation needed, against how many it would have needed
+// without the index, and how often the validation cache already had the answer.
+inline void LogValidationStats()
+{
+    const detail::ResourceStats& stats = detail::resourceStats;
+    logger::info(std::format("material validation: {} existence checks answered by the index, {} materials read, {} of them through an engine stream, {} known unchanged from the last launch ({} stream opens without the index)",
+        stats.probes.load(), stats.opens.load(), stats.engineOpens.load(), stats.reused.load(), stats.legacyOpens.load()));
+    auto rate = [](const detail::ValidationCache::Counter& c) {
+        return std::format("{} of {} ({}%)", c.hits, c.lookups, c.lookups ? c.hits * 100 / c.lookups : 0);
+    };
+    const detail::ValidationCache& cache = detail::validationCache;
+    logger::info(std::format("validation cache hits: material swaps {}, materials {}, textures {}",
+        rate(cache.swapStats), rate(cache.materialStats), rate(cache.textureStats)));
+}
+
+namespace detail
+{
+    // Whether a texture a material names exists, as named or under textures/. Memoized.
+    inline bool TextureExists(const std::string& tex)
+    {
+        validationCache.textureStats.lookups++;
+        const uint64_t key = TextureIndex::hash(tex);
+        if (auto it = validationCache.textures.find(key); it != validationCache.textures.end()) {
+            validationCache.textureStats.hits++;
+            return it->second;
+        }
+        // be lenient: "textures" prefix may or may not be present.
+        const bool bare = ResourceExists(tex.c_str());
+        resourceStats.legacyOpens += bare ? 1 : 2;
+        const bool exists = bare || ResourceExists(std::format("textures/{}", tex).c_str());
+        validationCache.textures.emplace(key, exists);
+        return exists;
+    }
+
+    // Verdicts from the last launch, and this launch's to save for the next. Loaded and saved by
+    // omod validation, on its thread.
+    inline OmodVerdictCache omodVerdicts;
+
+    // A material path as the caches key it: lowercase, with '/'.
+    inline std::string MaterialKey(const char* matPath)
+    {
+        std::string key(matPath);
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return c == '\\' ? '/' : (char)std::tolower(c); });
+        return key;
+    }
+
+    // Whether a material is as it was when a saved omod verdict relied on it: read from the same
+    // loose file or archive, unchanged, or found nowhere then and (the index being the same) now.
+    // A material found nowhere is looked for again when the engine may be asked for it.
+    inline bool MaterialUnchanged(const std::string& key)
+    {
+        const MaterialVerdict* saved = omodVerdicts.savedMaterial(key);
+        if (!saved || (!saved->found && (!omodVerdicts.sameIndex() || engineMaterialReads))) return false;
+        FileOrigin origin;
+        return !saved->found || (GetGeneralArchives().origin(saved->resolved, origin) && origin == saved->origin);
+    }
+
+    // Reads a material and checks the textures it names, the first time it is asked about.
+    inline const MaterialCheck& CheckMaterial(const char* matPath)
+    {
+        std::string key = MaterialKey(matPath);
+        validationCache.materialStats.lookups++;
+        if (auto it = validationCache.materials.find(key); it != validationCache.materials.end()) {
+            validationCache.materialStats.hits++;
+            return it->second;
+        }
+        MaterialCheck& check = validationCache.materials[key];
+
+        // be lenient: "materials" prefix may or may not be present. The index says which of the two
+        // to open; if it knows neither, both are tried as before.
+        const std::string prefixed = std::format("materials/{}", matPath);
+        const char* found = ResourceExists(matPath) ? matPath : ResourceExists(prefixed.c_str()) ? prefixed.c_str() : nullptr;
+        resourceStats.legacyOpens += found == matPath ? 1 : 2;
+
+        // 1) Can we open the BGSM/BGEM at all? Not if the last launch's reading of it still holds:
+        // the same file, unchanged, names the same textures.
+        MaterialVerdict verdict;
+        bool keep = true;
+        FileOrigin origin;
+        if (const MaterialVerdict* saved = omodVerdicts.savedMaterial(key); saved && (saved->found
+                ? found && saved->resolved == found && GetGeneralArchives().origin(found, origin) && origin == saved->origin
+                : !found && omodVerdicts.sameIndex() && !engineMaterialReads)) {
+            verdict = *saved;
+            resourceStats.reused++;
+        }
+        else {
+            std::vector<std::uint8_t> bytes;
+            const char* read = nullptr;
+            bool fromArchives = false;
+            if (found) {
+                if (ReadWholeFile(found, bytes, engineMaterialReads, &fromArchives)) read = found;
             }
-            else {
-                flush();
+            else if (ReadWholeFile(matPath, bytes, engineMaterialReads, &fromArchives)) read = matPath;
+            else if (ReadWholeFile(prefixed.c_str(), bytes, engineMaterialReads, &fromArchives)) read = prefixed.c_str();
+            if (read) {
+                // 2) Read the texture slots. Some minimal materials might not reference textures
+                // (rare), treat as OK
+                verdict.found = true;
+                verdict.resolved = read;
+                verdict.textures = ExtractTexturePaths(matPath, bytes);
+                // Only a file our own reader got can be checked for changes next time.
+                keep = fromArchives && GetGeneralArchives().origin(read, verdict.origin);
             }
         }
-        flush();
-
-        // De-dup (case-insensitive)
-        std::unordered_set<std::string> seen;
-        std::vector<std::string> unique;
-        for (auto& p : paths) {
-            std::string key = p;
-            std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
-            if (!seen.count(key)) {
-                seen.insert(std::move(key));
-                unique.emplace_back(std::move(p));
-            }
+        if (keep) omodVerdicts.record(key, verdict);
+        check.found = verdict.found;
+
+        // 3) Probe each texture in the index
+        for (auto& tex : verdict.textures) {
+            (TextureExists(tex) ? check.okTextures : check.missingTextures).push_back(std::move(tex));
         }
-        return unique;
+        return check;
     }
 }
 
@@ -137,32 +297,14 @@ inline SwapPreflightReport PreflightValidateBGSMTextures(const RE::BGSMaterialSw
             continue;
         }
 
-        // 1) Can we open the BGSM/BGEM at all?
-        std::vector<std::uint8_t> bytes;
-        // be lenient: "materials" prefix may or may not be present.
-        if (!ReadWholeFile(matPath, bytes) && !ReadWholeFile(std::format("materials/{}", matPath).c_str(), bytes)) {
+        const MaterialCheck& check = CheckMaterial(matPath);
+        if (!check.found) {
             report.missingMaterials.emplace_back(matPath);
             continue;
         }
         report.okMaterials.emplace_back(matPath);
-
-        // 2) Extract all .dds-like substrings from the material bytes
-        auto ddsPaths = ExtractDDSPaths(bytes);
-        if (ddsPaths.empty()) {
-            // Some minimal materials might not reference textures (rare), treat as OK
-            continue;
-        }
-
-        // 3) Probe each .dds via resource loader
-        for (auto& tex : ddsPaths) {
-            // be lenient: "textures" prefix may or may not be present.
-            if (ResourceExists(tex.c_str()) || ResourceExists(std::format("textures/{}", tex).c_str())) {
-                report.okTextures.emplace_back(tex);
-            }
-            else {
-                report.missingTextures.emplace_back(tex);
-            }
-        }
+        report.okTextures.insert(report.okTextures.end(), check.okTextures.begin(), check.okTextures.end());
+        report.missingTextures.insert(report.missingTextures.end(), check.missingTextures.begin(), check.missingTextures.end());
     }
 
     return report;
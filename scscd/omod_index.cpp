@@ -0,0 +1,88 @@
+#include "scscd.h"
+#include "omod_index.h"
+#include "thread_pool.h"
+
+void OmodIndex::BuildFromCatalog(const RecordCatalog& catalog)
+{
+    logger::trace("> OmodIndex::BuildFromCatalog()");
+    auto start = std::chrono::steady_clock::now();
+    mods_all_.clear();
+    mods_for_armo_.clear();
+    compat_row_.clear();
+    compat_offsets_.clear();
+    compat_omods_.clear();
+
+    const auto& armo = catalog.armo;
+    const auto& omod = catalog.omod;
+    std::vector<uint32_t> armorMods; // omod rows
+    for (uint32_t row = 0; row < omod.formID.size(); row++) {
+        mods_all_.push_back(omod.formID[row]);
+        if (omod.formType[row] == FOURCC('A', 'R', 'M', 'O')) {
+            mods_for_armo_.push_back(omod.formID[row]);
+            armorMods.push_back(row);
+        }
+    }
+
+    // Inverted index: keyword -> armor rows that carry it, as (keyword, row) pairs sorted by
+    // keyword so that each keyword's postings are one contiguous run.
+    std::vector<std::pair<uint32_t, uint32_t>> postings;
+    for (uint32_t row = 0; row < armo.formID.size(); row++) {
+        for (uint32_t keyword : catalog.list(armo.keywords[row]))
+            postings.emplace_back(keyword, row);
+    }
+    std::sort(postings.begin(), postings.end());
+    postings.erase(std::unique(postings.begin(), postings.end()), postings.end());
+    auto postingsFor = [&postings](uint32_t keyword) {
+        auto lo = std::lower_bound(postings.begin(), postings.end(), std::make_pair(keyword, 0u));
+        auto hi = lo;
+        while (hi != postings.end() && hi->first == keyword) ++hi;
+        return std::span<const std::pair<uint32_t, uint32_t>>(postings).subspan(lo - postings.begin(), hi - lo);
+    };
+
+    // Join each OMOD's target keywords against the postings, then keep the armors that offer its
+    // attach point. Each OMOD is independent, so they are spread over the workers, each writing
+    // only its own list of armor rows.
+    std::vector<std::vector<uint32_t>> matches(armorMods.size());
+    parallel_for(armorMods.size(), [&](size_t i) {
+        const uint32_t row = armorMods[i];
+        std::vector<uint32_t>& out = matches[i];
+        for (uint32_t keyword : catalog.list(omod.targetKeywords[row])) {
+            for (const auto& posting : postingsFor(keyword))
+                out.push_back(posting.second);
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+
+        if (const uint32_t attachPoint = omod.attachPoint[row]) {
+            std::erase_if(out, [&](uint32_t armoRow) {
+                auto slots = catalog.list(armo.attachParents[armoRow]);
+                return std::find(slots.begin(), slots.end(), attachPoint) == slots.end();
+            });
+        }
+    });
+
+    // Flatten to armor rows, in OMOD load order within each armor.
+    std::vector<uint32_t> counts(armo.formID.size() + 1, 0);
+    for (const auto& m : matches)
+        for (uint32_t armoRow : m) counts[armoRow + 1]++;
+    compat_offsets_.assign(armo.formID.size() + 1, 0);
+    for (size_t r = 0; r < armo.formID.size(); r++)
+        compat_offsets_[r + 1] = compat_offsets_[r] + counts[r + 1];
+    compat_omods_.resize(compat_offsets_.back());
+    std::vector<uint32_t> fill(compat_offsets_.begin(), compat_offsets_.end() - 1);
+    for (size_t i = 0; i < matches.size(); i++)
+        for (uint32_t armoRow : matches[i]) compat_omods_[fill[armoRow]++] = omod.formID[armorMods[i]];
+
+    size_t armors = 0;
+    for (uint32_t r = 0; r < armo.formID.size(); r++) {
+        if (compat_offsets_[r + 1] > compat_offsets_[r]) {
+            compat_row_.emplace(armo.formID[r], r);
+            armors++;
+        }
+    }
+
+    logger::info(std::format("omod index: {} omods ({} for armor), {} keyword postings; {} armors have {} compatible omods in total; {} ms",
+        mods_all_.size(), mods_for_armo_.size(), postings.size(), armors, compat_omods_.size(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()));
+    logger::trace("< OmodIndex::BuildFromCatalog()");
+}
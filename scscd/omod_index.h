@@ -4,6 +4,7 @@
 #include <span>
 #include "_fallout.h"
 #include "logger.h"
+#include "plugin_catalog.h"
 
 class OmodIndex
 {
@@ -14,34 +15,20 @@ public:
         return s;
     }
 
-    // Call this ONCE at startup after you've built a list of all forms (via your GetAllForms()).
-    // Pass them in here to build a stable OMOD list / map for later queries.
-    void BuildFromAllForms()
-    {
-        logger::trace("> OmodIndex::BuildFromAllForms()");
-        mods_all_.clear();
-        mods_for_armo_.clear();
-        //omod_to_loose_.clear();
-        const auto& [map, lock] = RE::TESForm::GetAllForms();
-        if (!map) {
-            logger::warn("BUG: could not get all forms");
-            return;
-        }
-        RE::BSAutoReadLock l{ lock };
-        for (auto &entry : *map) {
-            uint32_t formID = entry.first;
-            RE::TESForm* form = entry.second;
-            if (!form) continue;
-            if (form->GetFormType() != RE::ENUM_FORM_ID::kOMOD) continue; // restrict to OMODs
-
-            auto* mod = static_cast<RE::BGSMod::Attachment::Mod*>(form);
-            mods_all_.push_back(mod->GetFormID());
+    // Call this ONCE at startup, after the plugin catalog has been built (see ArmorIndex::catalog()).
+    // Builds the OMOD lists below and the armor -> compatible OMOD index straight from the plugin
+    // records, so the engine's form map is never walked and its lock never taken.
+    void BuildFromCatalog(const RecordCatalog& catalog);
 
-            // Prefilter: only keep mods whose targetFormType includes ARMO
-            if (mod->targetFormType.get() == RE::ENUM_FORM_ID::kARMO)
-                mods_for_armo_.push_back(formID);
-        }
-        logger::trace(std::format("< OmodIndex::BuildFromAllForms() mods_all={} mods_for_armo={}", mods_all_.size(), mods_for_armo_.size()));
+    // OMODs that can attach to the given armor: the OMOD targets ARMO, one of its target keywords
+    // (MNAM) is on the armor, and its attach point, if it has one, is among the armor's attach
+    // parent slots (APPR). Empty for armors not in the catalog.
+    std::span<const uint32_t> CompatibleWith(uint32_t armoFormID) const
+    {
+        auto it = compat_row_.find(armoFormID);
+        if (it == compat_row_.end()) return {};
+        const uint32_t begin = compat_offsets_[it->second], end = compat_offsets_[it->second + 1];
+        return { compat_omods_.data() + begin, end - begin };
     }
 
     // Return OMODs suitable for ARMO (prefiltered roughly; final legality will be
@@ -63,5 +50,10 @@ private:
 
     std::vector<uint32_t> mods_all_;
     std::vector<uint32_t> mods_for_armo_;
+
+    // armor form ID -> row; row r's OMODs are compat_omods_[compat_offsets_[r], compat_offsets_[r + 1])
+    std::unordered_map<uint32_t, uint32_t> compat_row_;
+    std::vector<uint32_t> compat_offsets_;
+    std::vector<uint32_t> compat_omods_;
     //std::unordered_map<const RE::BGSMod::Attachment::Mod*, RE::TESObjectMISC*> omod_to_loose_;
 };
@@ -0,0 +1,174 @@
+#include "omod_verdict_cache.h"
+#include "logger.h"
+#include "mapped_file.h"
+#include "plugin_format.h"
+#include <cstring>
+#include <format>
+#include <fstream>
+
+static constexpr uint32_t CACHE_MAGIC = FOURCC('S', 'O', 'V', 'C');
+// Bump whenever the file layout or what validation checks changes.
+static constexpr uint32_t CACHE_VERSION = 2;
+
+namespace {
+    // Bounds-checked cursor over the mapped cache file.
+    struct Reader {
+        std::span<const uint8_t> buf;
+        size_t off{ 0 };
+
+        template <class T>
+        bool get(T& v) {
+            if (buf.size() - off < sizeof(T)) return false;
+            std::memcpy(&v, buf.data() + off, sizeof(T));
+            off += sizeof(T);
+            return true;
+        }
+        bool str(std::string& s) {
+            uint16_t len = 0;
+            if (!get(len) || buf.size() - off < len) return false;
+            s.assign(reinterpret_cast<const char*>(buf.data() + off), len);
+            off += len;
+            return true;
+        }
+        // A u32 count, then that many strings.
+        bool strs(std::vector<std::string>& v) {
+            uint32_t n = 0;
+            if (!get(n) || (buf.size() - off) / sizeof(uint16_t) < n) return false;
+            v.resize(n);
+            for (std::string& s : v) {
+                if (!str(s)) return false;
+            }
+            return true;
+        }
+    };
+
+    template <class T>
+    void put(std::ofstream& f, const T& v) {
+        f.write(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    void put_str(std::ofstream& f, const std::string& s) {
+        put(f, (uint16_t)s.size());
+        f.write(s.data(), s.size());
+    }
+
+    void put_strs(std::ofstream& f, const std::vector<std::string>& v) {
+        put(f, (uint32_t)v.size());
+        for (const std::string& s : v) put_str(f, s);
+    }
+}
+
+bool OmodVerdictCache::load(const std::filesystem::path& path, uint64_t indexFingerprint)
+{
+    savedMaterials.clear();
+    savedOmods.clear();
+    index = indexFingerprint;
+    sameIndex_ = false;
+    MappedFile mapped(path);
+    if (!mapped.ok()) {
+        logger::debug(std::format("no omod verdict cache at {}", path.string()));
+        return false;
+    }
+
+    Reader r{ mapped.bytes() };
+    uint32_t magic = 0, version = 0, materialCount = 0, omodCount = 0;
+    uint64_t savedIndex = 0;
+    if (!r.get(magic) || !r.get(version) || !r.get(savedIndex) || magic != CACHE_MAGIC || version != CACHE_VERSION) {
+        logger::info(std::format("omod verdict cache {} is from another version; it will be rebuilt", path.string()));
+        return false;
+    }
+
+    bool ok = r.get(materialCount);
+    for (uint32_t i = 0; ok && i < materialCount; i++) {
+        std::string key;
+        MaterialVerdict m;
+        uint8_t found = 0;
+        ok = r.str(key) && r.get(found) && r.str(m.resolved) && r.str(m.origin.source)
+            && r.get(m.origin.size) && r.get(m.origin.mtime) && r.strs(m.textures);
+        m.found = found != 0;
+        if (ok) savedMaterials.emplace(std::move(key), std::move(m));
+    }
+    ok = ok && r.get(omodCount);
+    for (uint32_t i = 0; ok && i < omodCount; i++) {
+        std::string key;
+        OmodVerdict o;
+        uint8_t valid = 0;
+        ok = r.str(key) && r.get(valid) && r.strs(o.materials);
+        o.valid = valid != 0;
+        if (ok) savedOmods.emplace(std::move(key), std::move(o));
+    }
+
+    if (!ok) {
+        logger::warn(std::format("omod verdict cache {} is damaged; it will be rebuilt", path.string()));
+        savedMaterials.clear();
+        savedOmods.clear();
+        return false;
+    }
+    sameIndex_ = savedIndex == indexFingerprint;
+    return true;
+}
+
+bool OmodVerdictCache::save(const std::filesystem::path& path) const
+{
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // Write beside the real file and swap it in, so a crash mid-write can't leave a torn cache.
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) {
+            logger::warn(std::format("could not write omod verdict cache {}", tmp.string()));
+            return false;
+        }
+        put(f, CACHE_MAGIC);
+        put(f, CACHE_VERSION);
+        put(f, index);
+        put(f, (uint32_t)materials.size());
+        for (const auto& [key, m] : materials) {
+            put_str(f, key);
+            put(f, (uint8_t)m.found);
+            put_str(f, m.resolved);
+            put_str(f, m.origin.source);
+            put(f, m.origin.size);
+            put(f, m.origin.mtime);
+            put_strs(f, m.textures);
+        }
+        put(f, (uint32_t)omods.size());
+        for (const auto& [key, o] : omods) {
+            put_str(f, key);
+            put(f, (uint8_t)o.valid);
+            put_strs(f, o.materials);
+        }
+        if (!f) {
+            logger::warn(std::format("could not write omod verdict cache {}", tmp.string()));
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        logger::warn(std::format("could not replace omod verdict cache {}: {}", path.string(), ec.message()));
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+const MaterialVerdict* OmodVerdictCache::savedMaterial(const std::string& key) const
+{
+    auto it = savedMaterials.find(key);
+    return it != savedMaterials.end() ? &it->second : nullptr;
+}
+
+const OmodVerdict* OmodVerdictCache::savedOmod(const std::string& key) const
+{
+    auto it = savedOmods.find(key);
+    return it != savedOmods.end() ? &it->second : nullptr;
+}
+
+void OmodVerdictCache::keepMaterial(const std::string& key)
+{
+    if (const MaterialVerdict* m = savedMaterial(key)) materials.insert_or_assign(key, *m);
+}
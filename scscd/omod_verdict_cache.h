@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ba2_archive.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Where the omod verdict cache lives, relative to the Data folder.
+inline constexpr const char* OMOD_VERDICT_CACHE_FILE = "F4SE\\Plugins\\scscd\\cache\\omod_verdicts.bin";
+
+// What validating one material found: whether it could be read, the path that was read (as named,
+// or under materials/), where that file came from, and the textures it names. Only materials
+// read out of a loose file or a general archive are recorded, as only their origin can be
+// checked again; a material that was found nowhere is recorded with just `found` false.
+struct MaterialVerdict {
+    bool found{ false };
+    std::string resolved;
+    FileOrigin origin;
+    std::vector<std::string> textures;
+};
+
+// An omod's verdict, and the materials its swaps named when it was reached: lowercase with '/',
+// sorted, each once.
+struct OmodVerdict {
+    bool valid{ false };
+    std::vector<std::string> materials;
+};
+
+// Omod validation verdicts kept between launches, under the scscd data folder. Whether an omod's
+// materials and textures exist only changes when the archives or loose files do, so a verdict is
+// reused as long as the omod names the same materials, each still comes from the same unchanged
+// loose file or archive, and the texture index (see TextureIndex::fingerprint()) is the one the
+// verdict was worked out against. A material whose own origin is unchanged needn't be read again
+// even when the index changed; only its textures are looked up again.
+//
+// Materials are keyed by their path as named (lowercase, '/'), omods by plugin file name and
+// object ID, so neither depends on load order. Only what this launch validated or reused is
+// saved, so verdicts for omods that are gone don't pile up.
+class OmodVerdictCache {
+    std::unordered_map<std::string, MaterialVerdict> savedMaterials, materials;
+    std::unordered_map<std::string, OmodVerdict> savedOmods, omods;
+    uint64_t index{ 0 };
+    bool sameIndex_{ false };
+
+public:
+    // Reads the cache file, given the texture index's fingerprint this launch. A missing,
+    // truncated or outdated file just leaves the cache empty.
+    bool load(const std::filesystem::path& path, uint64_t indexFingerprint);
+
+    // Writes what was recorded or kept this launch, replacing the file.
+    bool save(const std::filesystem::path& path) const;
+
+    // Whether the saved verdicts were worked out against the texture index as it is now.
+    bool sameIndex() const { return sameIndex_; }
+
+    const MaterialVerdict* savedMaterial(const std::string& key) const;
+    const OmodVerdict* savedOmod(const std::string& key) const;
+
+    void record(const std::string& key, MaterialVerdict verdict) { materials.insert_or_assign(key, std::move(verdict)); }
+    void record(const std::string& key, OmodVerdict verdict) { omods.insert_or_assign(key, std::move(verdict)); }
+
+    // Carries a saved material verdict over to this launch's, unchanged.
+    void keepMaterial(const std::string& key);
+};
@@ -0,0 +1,302 @@
+#include "plugin_catalog.h"
+#include <algorithm>
+
+// OMOD DATA property value types whose first value is a form ID.
+static constexpr uint8_t PROPERTY_FORM_ID = 4;
+static constexpr uint8_t PROPERTY_FORM_ID_FLOAT = 6;
+
+// Appends every u32 in `sub` to `refs` and returns the span it occupies.
+static RecordCatalog::Refs append_ids(std::vector<uint32_t>& refs, std::span<const uint8_t> sub) {
+    RecordCatalog::Refs r{ static_cast<uint32_t>(refs.size()), static_cast<uint32_t>(sub.size() / 4) };
+    for (uint32_t i = 0; i < r.count; i++)
+        refs.push_back(rd_le32(sub.data() + i * 4));
+    return r;
+}
+
+static uint32_t first_id(std::span<const uint8_t> sub) {
+    return sub.size() >= 4 ? rd_le32(sub.data()) : 0;
+}
+
+bool RecordCatalog::capture(uint32_t sig, uint32_t formID, std::span<const uint8_t> payload) {
+    switch (sig) {
+    case FOURCC('A', 'R', 'M', 'O'): {
+        uint32_t slots = 0, armorRace = 0;
+        Refs keywords, attachParents;
+        std::vector<uint32_t> addons;
+        bool inAddon = false;
+        for_each_subrecord(payload, [&](const char* type, std::span<const uint8_t> sub) {
+            if (std::memcmp(type, "BOD2", 4) == 0) slots = first_id(sub);
+            else if (std::memcmp(type, "RNAM", 4) == 0) armorRace = first_id(sub);
+            else if (std::memcmp(type, "KWDA", 4) == 0) keywords = append_ids(refs, sub);
+            else if (std::memcmp(type, "APPR", 4) == 0) attachParents = append_ids(refs, sub);
+            // MODL is an addon only when it follows an INDX; elsewhere it's a model path.
+            else if (std::memcmp(type, "INDX", 4) == 0) inAddon = true;
+            else if (inAddon && std::memcmp(type, "MODL", 4) == 0 && sub.size() == 4) addons.push_back(rd_le32(sub.data()));
+            return true;
+        });
+        armo.formID.push_back(formID);
+        armo.slots.push_back(slots);
+        armo.race.push_back(armorRace);
+        armo.keywords.push_back(keywords);
+        armo.attachParents.push_back(attachParents);
+        armo.addons.push_back({ static_cast<uint32_t>(refs.size()), static_cast<uint32_t>(addons.size()) });
+        refs.insert(refs.end(), addons.begin(), addons.end());
+        return true;
+    }
+
+    case FOURCC('A', 'R', 'M', 'A'): {
+        uint32_t addonRace = 0;
+        Refs additionalRaces{ static_cast<uint32_t>(refs.size()), 0 };
+        uint8_t models = 0;
+        for_each_subrecord(payload, [&](const char* type, std::span<const uint8_t> sub) {
+            if (std::memcmp(type, "RNAM", 4) == 0) addonRace = first_id(sub);
+            else if (std::memcmp(type, "MODL", 4) == 0 && sub.size() == 4) {
+                // additional races are the only thing that touches `refs` in an ARMA, so they
+                // stay contiguous
+                refs.push_back(rd_le32(sub.data()));
+                additionalRaces.count++;
+            }
+            else if (std::memcmp(type, "MOD2", 4) == 0 && !zstring(sub).empty()) models |= MODEL_MALE;
+            else if (std::memcmp(type, "MOD3", 4) == 0 && !zstring(sub).empty()) models |= MODEL_FEMALE;
+            else if (std::memcmp(type, "MOD4", 4) == 0 && !zstring(sub).empty()) models |= MODEL_MALE_1ST;
+            else if (std::memcmp(type, "MOD5", 4) == 0 && !zstring(sub).empty()) models |= MODEL_FEMALE_1ST;
+            return true;
+        });
+        arma.formID.push_back(formID);
+        arma.race.push_back(addonRace);
+        arma.additionalRaces.push_back(additionalRaces);
+        arma.models.push_back(models);
+        return true;
+    }
+
+    case FOURCC('O', 'M', 'O', 'D'): {
+        uint32_t formType = 0, attachPoint = 0;
+        Refs attachParentSlots, targetKeywords;
+        Refs props{ static_cast<uint32_t>(properties.size()), 0 };
+        for_each_subrecord(payload, [&](const char* type, std::span<const uint8_t> sub) {
+            if (std::memcmp(type, "MNAM", 4) == 0) {
+                targetKeywords = append_ids(refs, sub);
+                return true;
+            }
+            if (std::memcmp(type, "DATA", 4) != 0) return true;
+
+            // includeCount u32, propertyCount u32, 2 x u8, formType u32, maxRank u8, levelTier u8,
+            // attachPoint u32, then counted arrays of attach parent slots, items, includes and
+            // properties. Anything that runs past the end is dropped, not guessed at.
+            const uint8_t* p = sub.data();
+            const uint8_t* end = p + sub.size();
+            if (end - p < 20) return true;
+            const uint32_t includeCount = rd_le32(p);
+            const uint32_t propertyCount = rd_le32(p + 4);
+            formType = rd_le32(p + 10);
+            attachPoint = rd_le32(p + 16);
+            p += 20;
+
+            if (end - p < 4) return true;
+            uint32_t n = rd_le32(p);
+            p += 4;
+            if (static_cast<uint64_t>(end - p) < uint64_t(n) * 4) return true;
+            attachParentSlots = append_ids(refs, { p, n * 4 });
+            p += n * 4;
+
+            if (end - p < 4) return true;
+            n = rd_le32(p);
+            p += 4;
+            if (static_cast<uint64_t>(end - p) < uint64_t(n) * 8) return true;
+            p += n * 8; // items
+
+            if (static_cast<uint64_t>(end - p) < uint64_t(includeCount) * 7) return true;
+            p += includeCount * 7;
+
+            for (uint32_t i = 0; i < propertyCount && end - p >= 24; i++, p += 24) {
+                Property prop;
+                prop.valueType = p[0];
+                prop.functionType = p[4];
+                prop.property = rd_le16(p + 8);
+                prop.value1 = rd_le32(p + 12);
+                prop.value2 = rd_le32(p + 16);
+                std::memcpy(&prop.step, p + 20, 4);
+                properties.push_back(prop);
+                props.count++;
+            }
+            return true;
+        });
+        omod.formID.push_back(formID);
+        omod.formType.push_back(formType);
+        omod.attachPoint.push_back(attachPoint);
+        omod.attachParentSlots.push_back(attachParentSlots);
+        omod.targetKeywords.push_back(targetKeywords);
+        omod.properties.push_back(props);
+        return true;
+    }
+
+    case FOURCC('R', 'A', 'C', 'E'): {
+        uint32_t armorRace = 0;
+        for_each_subrecord(payload, [&](const char* type, std::span<const uint8_t> sub) {
+            if (std::memcmp(type, "RNAM", 4) == 0) armorRace = first_id(sub);
+            return true;
+        });
+        race.formID.push_back(formID);
+        race.armorRace.push_back(armorRace);
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+// Finds the row for `formID`, or appends an empty one. Overrides reuse the row of the record they
+// override; their reference lists are appended again and the old ones are left unreferenced.
+template <class Columns>
+static uint32_t merge_row(std::unordered_map<uint32_t, uint32_t>& rows, Columns& columns, uint32_t formID, auto&& append) {
+    auto [it, added] = rows.try_emplace(formID, static_cast<uint32_t>(columns.formID.size()));
+    if (added) {
+        columns.formID.push_back(formID);
+        append();
+    }
+    return it->second;
+}
+
+void RecordCatalog::merge(const RecordCatalog& plugin, const std::function<uint32_t(uint32_t)>& toRuntime) {
+    auto refList = [&](Refs r) {
+        Refs out{ static_cast<uint32_t>(refs.size()), 0 };
+        for (uint32_t id : plugin.list(r)) {
+            if (uint32_t runtime = id ? toRuntime(id) : 0) {
+                refs.push_back(runtime);
+                out.count++;
+            }
+        }
+        return out;
+    };
+    auto ref = [&](uint32_t id) { return id ? toRuntime(id) : 0; };
+
+    for (size_t i = 0; i < plugin.armo.formID.size(); i++) {
+        const uint32_t id = ref(plugin.armo.formID[i]);
+        if (!id) continue;
+        const uint32_t row = merge_row(armoRow, armo, id, [&] {
+            armo.slots.emplace_back(); armo.race.emplace_back(); armo.keywords.emplace_back();
+            armo.attachParents.emplace_back(); armo.addons.emplace_back();
+        });
+        armo.slots[row] = plugin.armo.slots[i];
+        armo.race[row] = ref(plugin.armo.race[i]);
+        armo.keywords[row] = refList(plugin.armo.keywords[i]);
+        armo.attachParents[row] = refList(plugin.armo.attachParents[i]);
+        armo.addons[row] = refList(plugin.armo.addons[i]);
+    }
+
+    for (size_t i = 0; i < plugin.arma.formID.size(); i++) {
+        const uint32_t id = ref(plugin.arma.formID[i]);
+        if (!id) continue;
+        const uint32_t row = merge_row(armaRow, arma, id, [&] {
+            arma.race.emplace_back(); arma.additionalRaces.emplace_back(); arma.models.emplace_back();
+        });
+        arma.race[row] = ref(plugin.arma.race[i]);
+        arma.additionalRaces[row] = refList(plugin.arma.additionalRaces[i]);
+        arma.models[row] = plugin.arma.models[i];
+    }
+
+    for (size_t i = 0; i < plugin.omod.formID.size(); i++) {
+        const uint32_t id = ref(plugin.omod.formID[i]);
+        if (!id) continue;
+        const uint32_t row = merge_row(omodRow, omod, id, [&] {
+            omod.formType.emplace_back(); omod.attachPoint.emplace_back(); omod.attachParentSlots.emplace_back();
+            omod.targetKeywords.emplace_back(); omod.properties.emplace_back();
+        });
+        omod.formType[row] = plugin.omod.formType[i];
+        omod.attachPoint[row] = ref(plugin.omod.attachPoint[i]);
+        omod.attachParentSlots[row] = refList(plugin.omod.attachParentSlots[i]);
+        omod.targetKeywords[row] = refList(plugin.omod.targetKeywords[i]);
+
+        const Refs src = plugin.omod.properties[i];
+        omod.properties[row] = { static_cast<uint32_t>(properties.size()), src.count };
+        for (uint32_t p = 0; p < src.count; p++) {
+            Property prop = plugin.properties[src.offset + p];
+            if (prop.valueType == PROPERTY_FORM_ID || prop.valueType == PROPERTY_FORM_ID_FLOAT)
+                prop.value1 = ref(prop.value1);
+            properties.push_back(prop);
+        }
+    }
+
+    for (size_t i = 0; i < plugin.race.formID.size(); i++) {
+        const uint32_t id = ref(plugin.race.formID[i]);
+        if (!id) continue;
+        const uint32_t row = merge_row(raceRow, race, id, [&] { race.armorRace.emplace_back(); });
+        race.armorRace[row] = ref(plugin.race.armorRace[i]);
+    }
+}
+
+bool RecordCatalog::consistent() const {
+    auto inside = [](const std::vector<Refs>& column, size_t size) {
+        return std::all_of(column.begin(), column.end(), [&](Refs r) { return uint64_t(r.offset) + r.count <= size; });
+    };
+    const size_t a = armo.formID.size(), b = arma.formID.size(), o = omod.formID.size();
+    return armo.slots.size() == a && armo.race.size() == a && armo.keywords.size() == a
+        && armo.attachParents.size() == a && armo.addons.size() == a
+        && arma.race.size() == b && arma.additionalRaces.size() == b && arma.models.size() == b
+        && omod.formType.size() == o && omod.attachPoint.size() == o && omod.attachParentSlots.size() == o
+        && omod.targetKeywords.size() == o && omod.properties.size() == o
+        && race.armorRace.size() == race.formID.size()
+        && inside(armo.keywords, refs.size()) && inside(armo.attachParents, refs.size()) && inside(armo.addons, refs.size())
+        && inside(arma.additionalRaces, refs.size())
+        && inside(omod.attachParentSlots, refs.size()) && inside(omod.targetKeywords, refs.size())
+        && inside(omod.properties, properties.size());
+}
+
+size_t RecordCatalog::memoryBytes() const {
+    size_t bytes = 0;
+    forEachColumn([&](const auto& column) {
+        bytes += column.capacity() * sizeof(column[0]);
+    });
+    // node + bucket per row, going by MSVC's layout
+    bytes += (armoRow.size() + armaRow.size() + omodRow.size() + raceRow.size()) * (24 + 16);
+    return bytes;
+}
+
+std::optional<uint32_t> RecordCatalog::armorSexes(uint32_t armoFormID) const {
+    auto it = armoRow.find(armoFormID);
+    if (it == armoRow.end()) return std::nullopt;
+    uint32_t r = 0;
+    for (uint32_t addon : list(armo.addons[it->second])) {
+        auto a = armaRow.find(addon);
+        if (a == armaRow.end()) continue;
+        const uint8_t models = arma.models[a->second];
+        if (models & (MODEL_MALE | MODEL_MALE_1ST)) r |= 1;
+        if (models & (MODEL_FEMALE | MODEL_FEMALE_1ST)) r |= 2;
+    }
+    return r;
+}
+
+void RecordCatalog::addRaceWithParents(uint32_t id, std::vector<uint32_t>& out) const {
+    // armor parent chains are short, but guard against a cycle in a broken load order
+    for (int depth = 0; id && depth < 16; depth++) {
+        out.push_back(id);
+        auto it = raceRow.find(id);
+        if (it == raceRow.end()) break;
+        id = race.armorRace[it->second];
+    }
+}
+
+std::optional<std::vector<uint32_t>> RecordCatalog::armorRaces(uint32_t armoFormID) const {
+    auto it = armoRow.find(armoFormID);
+    if (it == armoRow.end()) return std::nullopt;
+    std::vector<uint32_t> out;
+    if (const uint32_t explicitRace = armo.race[it->second]) {
+        addRaceWithParents(explicitRace, out);
+        return out; // treat explicit as a hard restriction
+    }
+    for (uint32_t addon : list(armo.addons[it->second])) {
+        auto a = armaRow.find(addon);
+        if (a == armaRow.end()) continue;
+        addRaceWithParents(arma.race[a->second], out);
+        for (uint32_t r : list(arma.additionalRaces[a->second]))
+            addRaceWithParents(r, out);
+    }
+    return out;
+}
+
+std::optional<uint32_t> RecordCatalog::armorSlots(uint32_t armoFormID) const {
+    auto it = armoRow.find(armoFormID);
+    if (it == armoRow.end()) return std::nullopt;
+    return armo.slots[it->second];
+}
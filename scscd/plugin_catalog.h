@@ -0,0 +1,144 @@
+#pragma once
+
+#include "plugin_format.h"
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The fields of ARMO, ARMA, OMOD and RACE records that the armor model needs, captured straight
+// from the plugin files during the EDID scan so that tuple metadata (races, sexes, keywords) can
+// be computed without asking the engine for each form.
+//
+// Storage is columnar: each record type is a set of parallel vectors, one row per record, and
+// every variable-length list (keywords, races, addons, ...) is a Refs span into the shared `refs`
+// column. There is nothing in here that depends on the game, so it works the same on a Linux
+// box with only the plugin files.
+//
+// A catalog either holds one plugin's records, with form IDs exactly as stored in that file
+// (top byte = master index), or the merge of every plugin in load order, with runtime form IDs.
+class RecordCatalog {
+public:
+    struct Refs {
+        uint32_t offset{ 0 };
+        uint32_t count{ 0 };
+    };
+
+    // ARMA model presence bits
+    static constexpr uint8_t MODEL_MALE = 0x1;     // MOD2
+    static constexpr uint8_t MODEL_FEMALE = 0x2;   // MOD3
+    static constexpr uint8_t MODEL_MALE_1ST = 0x4; // MOD4
+    static constexpr uint8_t MODEL_FEMALE_1ST = 0x8; // MOD5
+
+    struct ArmorColumns {
+        std::vector<uint32_t> formID;
+        std::vector<uint32_t> slots;         // BOD2 biped object slots
+        std::vector<uint32_t> race;          // RNAM, 0 if none
+        std::vector<Refs> keywords;          // KWDA
+        std::vector<Refs> attachParents;     // APPR attach parent slot keywords
+        std::vector<Refs> addons;            // MODL armor addons
+    } armo;
+
+    struct AddonColumns {
+        std::vector<uint32_t> formID;
+        std::vector<uint32_t> race;          // RNAM
+        std::vector<Refs> additionalRaces;   // MODL
+        std::vector<uint8_t> models;         // MODEL_* bits
+    } arma;
+
+    // One OMOD DATA property, as stored in the file.
+    struct Property {
+        uint8_t valueType;
+        uint8_t functionType;
+        uint16_t property;
+        uint32_t value1;
+        uint32_t value2;
+        float step;
+    };
+
+    struct OmodColumns {
+        std::vector<uint32_t> formID;
+        std::vector<uint32_t> formType;      // record signature the mod applies to, e.g. 'ARMO'
+        std::vector<uint32_t> attachPoint;   // KYWD, 0 if none
+        std::vector<Refs> attachParentSlots;
+        std::vector<Refs> targetKeywords;    // MNAM
+        std::vector<Refs> properties;        // span of `properties` below, not `refs`
+    } omod;
+    std::vector<Property> properties;
+
+    struct RaceColumns {
+        std::vector<uint32_t> formID;
+        std::vector<uint32_t> armorRace;     // RNAM, 0 if none
+    } race;
+
+    std::vector<uint32_t> refs;
+
+    // Row lookup by form ID. Only built for a merged catalog.
+    std::unordered_map<uint32_t, uint32_t> armoRow, armaRow, omodRow, raceRow;
+
+    // Whether capture() wants records with this signature.
+    static bool catalogues(uint32_t sig) {
+        switch (sig) {
+        case FOURCC('A', 'R', 'M', 'O'):
+        case FOURCC('A', 'R', 'M', 'A'):
+        case FOURCC('O', 'M', 'O', 'D'):
+        case FOURCC('R', 'A', 'C', 'E'):
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Parses one decoded record payload into the matching columns. `sig` is the record's 4CC
+    // as a little-endian integer. Records of other types are ignored. Returns false if the
+    // record was not catalogued.
+    bool capture(uint32_t sig, uint32_t formID, std::span<const uint8_t> payload);
+
+    // Appends every row of a single plugin's catalog, translating each form ID (the record's
+    // own and every reference) with toRuntime. A row whose own form ID translates to 0 is
+    // dropped. Rows replace earlier rows with the same form ID, so merging plugins in load
+    // order leaves the winning override of each record.
+    void merge(const RecordCatalog& plugin, const std::function<uint32_t(uint32_t)>& toRuntime);
+
+    std::span<const uint32_t> list(Refs r) const { return { refs.data() + r.offset, r.count }; }
+
+    // True if every column of a record type has one entry per row and every Refs lies inside
+    // its column. Checked on catalogs read back from the cache.
+    bool consistent() const;
+
+    size_t records() const { return armo.formID.size() + arma.formID.size() + omod.formID.size() + race.formID.size(); }
+    size_t memoryBytes() const;
+
+    // Calls f(column) for every column vector. Used to (de)serialize the catalog.
+    template <class F>
+    void forEachColumn(F&& f) {
+        f(armo.formID); f(armo.slots); f(armo.race); f(armo.keywords); f(armo.attachParents); f(armo.addons);
+        f(arma.formID); f(arma.race); f(arma.additionalRaces); f(arma.models);
+        f(omod.formID); f(omod.formType); f(omod.attachPoint); f(omod.attachParentSlots); f(omod.targetKeywords); f(omod.properties);
+        f(properties);
+        f(race.formID); f(race.armorRace);
+        f(refs);
+    }
+    template <class F>
+    void forEachColumn(F&& f) const { const_cast<RecordCatalog*>(this)->forEachColumn([&f](const auto& c) { f(c); }); }
+
+    // Queries against a merged catalog. Each returns nullopt if the armor isn't catalogued, in
+    // which case the caller should fall back to the engine.
+
+    // Sexes with a model in any of the armor's addons: bit 0 male, bit 1 female (the same
+    // values as MALE and FEMALE in tuple.h).
+    std::optional<uint32_t> armorSexes(uint32_t armoFormID) const;
+
+    // Races the armor can be worn by, each followed by its chain of armor parent races. If the
+    // armor itself names a race that is a hard restriction; otherwise it's the union of its
+    // addons' races and additional races. May contain duplicates.
+    std::optional<std::vector<uint32_t>> armorRaces(uint32_t armoFormID) const;
+
+    std::optional<uint32_t> armorSlots(uint32_t armoFormID) const;
+
+private:
+    void addRaceWithParents(uint32_t race, std::vector<uint32_t>& out) const;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+// On-disk layout of ESM/ESP/ESL plugin files, and the small helpers every reader of them
+// shares. Nothing here depends on the game.
+
+constexpr uint32_t FOURCC(char a, char b, char c, char d) {
+    return (uint32_t(uint8_t(a))) |
+        (uint32_t(uint8_t(b)) << 8) |
+        (uint32_t(uint8_t(c)) << 16) |
+        (uint32_t(uint8_t(d)) << 24);
+}
+
+// One bit for each record type whose editor IDs are indexed, so that sets of them can be passed
+// around as a mask. Other signatures map to 0. FormTypeBit() in edid_table.h gives the same bits
+// for the engine's form types.
+constexpr uint32_t RecordTypeBit(uint32_t sig) {
+    switch (sig) {
+    case FOURCC('A', 'R', 'M', 'O'): return 1u << 0;
+    case FOURCC('A', 'R', 'M', 'A'): return 1u << 1;
+    case FOURCC('O', 'M', 'O', 'D'): return 1u << 2;
+    case FOURCC('N', 'P', 'C', '_'): return 1u << 3;
+    case FOURCC('R', 'A', 'C', 'E'): return 1u << 4;
+    case FOURCC('F', 'A', 'C', 'T'): return 1u << 5;
+    case FOURCC('C', 'L', 'A', 'S'): return 1u << 6;
+    default:                         return 0;
+    }
+}
+constexpr uint32_t ALL_RECORD_TYPE_BITS = 0x7F;
+
+struct RecordHeader {
+    char     sig[4];        // e.g. "ARMO", "NPC_", "OMOD", ...
+    uint32_t dataSize;
+    uint32_t flags;
+    uint32_t formID;
+    uint32_t vcInfo1;
+    uint16_t formVersion;
+    uint16_t vcInfo2;
+};
+
+struct GroupHeader {
+    char sig[4];       // "GRUP"
+    uint32_t groupSize;
+    uint32_t label;
+    uint32_t type;
+    uint16_t stamp;
+    uint16_t unknown;
+};
+
+// Both records and groups have a 24-byte header on disk. (GroupHeader above omits the trailing
+// version/unknown words, which we never look at.)
+static constexpr size_t HEADER_SIZE = 24;
+static constexpr uint32_t RECORD_FLAG_COMPRESSED = 0x00040000;
+
+static inline uint16_t rd_le16(const uint8_t* p) {
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+static inline uint32_t rd_le32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Calls fn(type, data) for each subrecord of a record payload, in order, until fn returns false.
+// An XXXX size prefix is folded into the subrecord it applies to. Iteration stops at the first
+// subrecord that does not fit in `data`, so a truncated prefix of a payload only ever yields
+// whole subrecords.
+template <class Fn>
+static void for_each_subrecord(std::span<const uint8_t> data, Fn&& fn)
+{
+    const uint8_t* buf = data.data();
+    const size_t n = data.size();
+
+    size_t off = 0;
+    uint32_t pendingBig = 0; // carries XXXX size to the next subrecord only
+
+    while (off + 6 <= n) {
+        const char* type = reinterpret_cast<const char*>(buf + off);
+        uint16_t sz16 = rd_le16(buf + off + 4);
+        off += 6;
+
+        // XXXX extends size of the *next* subrecord
+        if (std::memcmp(type, "XXXX", 4) == 0) {
+            // Per spec, size must be 4, and payload is a uint32 little-endian
+            if (sz16 != 4 || off + 4 > n) break;
+            pendingBig = rd_le32(buf + off);
+            off += 4;
+            // Loop continues; we do not consume any "real" subrecord yet
+            continue;
+        }
+
+        // Effective data size for this subrecord
+        uint32_t dsz = pendingBig ? pendingBig : sz16;
+        pendingBig = 0;
+
+        if (off + dsz > n) break; // bounds guard
+        if (!fn(type, data.subspan(off, dsz))) break;
+        off += dsz;
+    }
+}
+
+// A Z-string (ASCII/UTF-8) subrecord, without its terminator.
+inline std::string_view zstring(std::span<const uint8_t> sub)
+{
+    const char* s = reinterpret_cast<const char*>(sub.data());
+    size_t len = 0;
+    while (len < sub.size() && s[len] != '\0') ++len;
+    return std::string_view(s, len);
+}
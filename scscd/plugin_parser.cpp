@@ -0,0 +1,230 @@
+#include "plugin_parser.h"
+#include "async_io.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <zlib.h> // link zlib
+
+bool inflate_zlib(const uint8_t* src, size_t sz, size_t expected, std::vector<uint8_t>& out) {
+    out.resize(expected);
+    z_stream zs{};
+    zs.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(src));
+    zs.avail_in = static_cast<uInt>(sz);
+    zs.next_out = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+    if (inflateInit(&zs) != Z_OK) return false;
+    int ret = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+    return ret == Z_STREAM_END && zs.total_out == expected;
+}
+
+std::string_view parse_edid_from_record_bytes(std::span<const uint8_t> data)
+{
+    std::string_view edid;
+    for_each_subrecord(data, [&edid](const char* type, std::span<const uint8_t> sub) {
+        if (std::memcmp(type, "EDID", 4) != 0) return true;
+        edid = zstring(sub);
+        return false;
+    });
+    return edid; // empty if no EDID found
+}
+
+bool read_plugin_masters(const std::filesystem::path& path, std::vector<std::string>& masters)
+{
+    std::ifstream f(path, std::ios::binary);
+    RecordHeader rh;
+    if (!read_exact(f, &rh, sizeof(rh)) || std::memcmp(rh.sig, "TES4", 4) != 0) return false;
+    std::vector<uint8_t> data(rh.dataSize);
+    if (!read_exact(f, data.data(), data.size())) return false;
+    for_each_subrecord(data, [&masters](const char* type, std::span<const uint8_t> sub) {
+        if (std::memcmp(type, "MAST", 4) == 0)
+            masters.emplace_back(zstring(sub));
+        return true;
+    });
+    return true;
+}
+
+bool read_new_object_ids(const std::filesystem::path& path, std::vector<uint32_t>& ids)
+{
+    MappedFile mapped(path);
+    if (!mapped.ok()) return false;
+    const std::span<const uint8_t> bytes = mapped.bytes();
+    if (bytes.size() < HEADER_SIZE || std::memcmp(bytes.data(), "TES4", 4) != 0) return false;
+
+    RecordHeader tes4;
+    std::memcpy(&tes4, bytes.data(), sizeof(tes4));
+    if (tes4.dataSize > bytes.size() - HEADER_SIZE) return false;
+    uint32_t masters = 0;
+    for_each_subrecord(bytes.subspan(HEADER_SIZE, tes4.dataSize), [&masters](const char* type, std::span<const uint8_t>) {
+        if (std::memcmp(type, "MAST", 4) == 0) masters++;
+        return true;
+    });
+
+    // Groups are stored inline with their contents, so stepping over each group header (rather
+    // than the whole group) and each record in turn reaches every record in the file.
+    size_t off = HEADER_SIZE + tes4.dataSize;
+    while (bytes.size() - off >= HEADER_SIZE) {
+        const uint8_t* p = bytes.data() + off;
+        if (std::memcmp(p, "GRUP", 4) == 0) {
+            off += HEADER_SIZE;
+            continue;
+        }
+        RecordHeader rh;
+        std::memcpy(&rh, p, sizeof(rh));
+        if ((rh.formID >> 24) >= masters)
+            ids.push_back(rh.formID & 0x00FFFFFFu);
+        if (rh.dataSize > bytes.size() - off - HEADER_SIZE) break;
+        off += HEADER_SIZE + rh.dataSize;
+    }
+    return true;
+}
+
+namespace {
+    // One plugin's progress through read_plugin_groups(). Its header chain is strictly sequential
+    // (each group header says where the next one is), but the bodies it queues can complete in any
+    // order; they wait in `ready` until every earlier group has been handed over.
+    struct GroupChain {
+        int file{ -1 };
+        uint64_t size{ 0 };
+        uint32_t queued{ 0 }; // group bodies requested so far; only the header chain touches this
+        std::mutex m;
+        std::map<uint32_t, std::vector<uint8_t>> ready;
+        uint32_t delivered{ 0 }; // next group to hand over
+        bool draining{ false };  // some worker is handing groups over
+        std::atomic<bool> stopped{ false };
+        std::atomic<bool> failed{ false };
+    };
+}
+
+size_t read_plugin_groups(std::span<const std::filesystem::path> paths, uint32_t types,
+    const std::function<bool(size_t file, std::span<const uint8_t> group)>& fn, size_t depth, size_t workers)
+{
+    AsyncReader reader(depth, workers);
+    std::vector<GroupChain> chains(paths.size());
+
+    auto deliver = [&](size_t i, uint32_t seq, std::vector<uint8_t> body) {
+        GroupChain& c = chains[i];
+        std::unique_lock lock(c.m);
+        c.ready.emplace(seq, std::move(body));
+        if (c.draining) return; // whoever is draining will pick it up
+        c.draining = true;
+        for (auto it = c.ready.begin(); it != c.ready.end() && it->first == c.delivered; it = c.ready.begin()) {
+            std::vector<uint8_t> group = std::move(it->second);
+            c.ready.erase(it);
+            lock.unlock();
+            if (group.empty()) {
+                if (!c.failed.exchange(true))
+                    logger::warn(std::format("could not read a group of {}; some records skipped", paths[i].string()));
+            }
+            else if (!c.stopped && !fn(i, group)) {
+                c.stopped = true;
+            }
+            lock.lock();
+            c.delivered++;
+        }
+        c.draining = false;
+    };
+
+    std::function<void(size_t, uint64_t)> next_group = [&](size_t i, uint64_t off) {
+        GroupChain& c = chains[i];
+        if (c.stopped || off >= c.size || c.size - off < HEADER_SIZE) return;
+        reader.read(c.file, off, HEADER_SIZE, [&, i, off](std::vector<uint8_t> head) {
+            GroupChain& c = chains[i];
+            if (head.empty()) {
+                c.failed = true;
+                logger::warn(std::format("could not read {} at offset {}; rest of file ignored", paths[i].string(), off));
+                return;
+            }
+            GroupHeader gh;
+            std::memcpy(&gh, head.data(), sizeof(gh));
+            if (std::memcmp(gh.sig, "GRUP", 4) != 0 || gh.groupSize < HEADER_SIZE || gh.groupSize > c.size - off) {
+                logger::warn(std::format("{}: bad top-level group at offset {}; rest of file ignored", paths[i].string(), off));
+                return;
+            }
+            if (gh.type == 0 && (RecordTypeBit(gh.label) & types) && gh.groupSize > HEADER_SIZE) {
+                const uint32_t seq = c.queued++;
+                reader.read(c.file, off + HEADER_SIZE, gh.groupSize - HEADER_SIZE, [&deliver, i, seq](std::vector<uint8_t> body) {
+                    deliver(i, seq, std::move(body));
+                });
+            }
+            next_group(i, off + gh.groupSize);
+        });
+    };
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        GroupChain& c = chains[i];
+        c.file = reader.open(paths[i]);
+        if (c.file < 0) {
+            logger::warn(std::format("cannot access file {}", paths[i].string()));
+            c.failed = true;
+            continue;
+        }
+        c.size = reader.size(c.file);
+        reader.read(c.file, 0, HEADER_SIZE, [&, i](std::vector<uint8_t> head) {
+            if (head.empty() || std::memcmp(head.data(), "TES4", 4) != 0) {
+                logger::warn(std::format("{} is not a plugin", paths[i].string()));
+                chains[i].failed = true;
+                return;
+            }
+            RecordHeader tes4;
+            std::memcpy(&tes4, head.data(), sizeof(tes4));
+            next_group(i, HEADER_SIZE + uint64_t(tes4.dataSize));
+        });
+    }
+    reader.wait();
+
+    size_t failed = 0;
+    for (const GroupChain& c : chains) failed += c.failed;
+    return failed;
+}
+
+// Every thread keeps one inflater for its lifetime and resets it between records, rather than
+// paying for inflateInit/inflateEnd (and zlib's window allocation) on every compressed record.
+struct ThreadInflater {
+    z_stream zs{};
+    bool ready{ false };
+
+    ThreadInflater() { ready = inflateInit(&zs) == Z_OK; }
+    ~ThreadInflater() { if (ready) inflateEnd(&zs); }
+    ThreadInflater(const ThreadInflater&) = delete;
+    ThreadInflater& operator=(const ThreadInflater&) = delete;
+};
+
+// First slice of a compressed record to inflate. EDID is nearly always the first subrecord, so
+// this is usually the only slice we ever decode.
+static constexpr size_t INFLATE_FIRST_CHUNK = 256;
+
+// Inflates only as much of a compressed record as is needed to see its whole EDID subrecord
+// (including any XXXX size prefix), then stops. Output is produced into `scratch` in slices that
+// double in size, and the decoded prefix is re-walked after each slice; because the walk stops
+// at the first subrecord that is not yet complete, a prefix yields an EDID only if the full
+// payload would have yielded the same one. The returned view points into `scratch`.
+std::string_view inflate_edid(std::span<const uint8_t> comp, uint32_t uncompressedSize, std::vector<uint8_t>& scratch)
+{
+    static thread_local ThreadInflater inflater;
+    if (!inflater.ready || uncompressedSize == 0) return {};
+
+    z_stream& zs = inflater.zs;
+    if (inflateReset(&zs) != Z_OK) return {};
+    zs.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(comp.data()));
+    zs.avail_in = static_cast<uInt>(comp.size());
+
+    size_t produced = 0;
+    size_t want = std::min<size_t>(INFLATE_FIRST_CHUNK, uncompressedSize);
+    while (true) {
+        scratch.resize(want);
+        zs.next_out = reinterpret_cast<Bytef*>(scratch.data() + produced);
+        zs.avail_out = static_cast<uInt>(want - produced);
+        const int ret = inflate(&zs, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) return {};
+        produced = want - zs.avail_out;
+
+        std::string_view edid = parse_edid_from_record_bytes(std::span<const uint8_t>(scratch.data(), produced));
+        if (!edid.empty()) return edid;
+
+        // No EDID in the whole payload, or zlib can make no further progress.
+        if (ret == Z_STREAM_END || produced >= uncompressedSize) return {};
+        if (ret == Z_BUF_ERROR && zs.avail_in == 0) return {};
+        want = std::min<size_t>(want * 2, uncompressedSize);
+    }
+}
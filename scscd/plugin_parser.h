@@ -0,0 +1,319 @@
+#pragma once
+
+#include "plugin_format.h"
+#include "plugin_catalog.h"
+#include "mapped_file.h"
+#include "logger.h"
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Readers for ESM/ESP/ESL plugin files on disk. Nothing here depends on the game: records are
+// identified by their 4CC signature, and form IDs are reported exactly as stored in the file, so
+// the same code runs in the plugin and in the scscd-scan command line tool.
+
+inline bool read_exact(std::ifstream& f, void* p, size_t n) {
+    return !!f.read(reinterpret_cast<char*>(p), n);
+}
+
+// Inflates into `out`, reusing its capacity. Returns false on any zlib error or size mismatch.
+bool inflate_zlib(const uint8_t* src, size_t sz, size_t expected, std::vector<uint8_t>& out);
+
+// data: the record payload *after* the record header (already decompressed if needed).
+// The returned view points into `data`; copy it if it must outlive the buffer.
+std::string_view parse_edid_from_record_bytes(std::span<const uint8_t> data);
+
+// Inflates only as much of a compressed record as is needed to see its whole EDID subrecord.
+// The returned view points into `scratch`.
+std::string_view inflate_edid(std::span<const uint8_t> comp, uint32_t uncompressedSize, std::vector<uint8_t>& scratch);
+
+// Reads the master list (MAST subrecords, in order) from a plugin's TES4 header record.
+bool read_plugin_masters(const std::filesystem::path& path, std::vector<std::string>& masters);
+
+// Collects the object IDs (low 24 bits) of every record the plugin adds itself, as opposed to
+// overrides of its masters' records, from every group including the nested cell and world ones.
+// Only record headers are read.
+bool read_new_object_ids(const std::filesystem::path& path, std::vector<uint32_t>& ids);
+
+// Reads many plugins at once through an AsyncReader, `depth` reads deep, instead of mapping them one
+// at a time. Each plugin's chain of top-level group headers is followed with small reads, and the
+// whole body of every group whose label is in `types` is then read in one go. fn(file, group) gets
+// each of those bodies (records and nested groups, as walk_records() expects), where `file` is the
+// index into `paths`. A plugin's groups are handed over in file order, and never concurrently, so
+// fn may keep per-plugin state without locking; different plugins run in parallel on `workers`
+// threads. Returning false stops that plugin. Returns the number of plugins that could not be read
+// in full.
+size_t read_plugin_groups(std::span<const std::filesystem::path> paths, uint32_t types,
+    const std::function<bool(size_t file, std::span<const uint8_t> group)>& fn, size_t depth, size_t workers);
+
+// Walks the GRUP/record structure of a plugin image in place. Only top-level groups whose label
+// is one of the record types in `types` (a RecordTypeBit mask) are descended into; everything else
+// is hopped over by its group size without its pages ever being touched. visit(header, payload)
+// is called for every record that is reached, with payload still compressed if the record is.
+// Returns false if the visitor asked to stop.
+template <class Visitor>
+bool walk_records(std::span<const uint8_t> bytes, Visitor& visit, uint32_t types = ALL_RECORD_TYPE_BITS)
+{
+    size_t off = 0;
+    const size_t end = bytes.size();
+    while (end - off >= HEADER_SIZE) {
+        const uint8_t* p = bytes.data() + off;
+
+        if (std::memcmp(p, "GRUP", 4) == 0) {
+            GroupHeader gh;
+            std::memcpy(&gh, p, sizeof(gh));
+            if (gh.groupSize < HEADER_SIZE || gh.groupSize > end - off) {
+                logger::warn(std::format("group at offset {} has bad size {}; rest of file ignored", off, gh.groupSize));
+                return true;
+            }
+            // Top-level groups (type==0): label is record 4CC. Filter here.
+            // Not top-level: we don't need REFR/ACHR/etc, skip entirely.
+            if (gh.type == 0 && (RecordTypeBit(gh.label) & types)) {
+                if (!walk_records(bytes.subspan(off + HEADER_SIZE, gh.groupSize - HEADER_SIZE), visit, types))
+                    return false;
+            }
+            off += gh.groupSize;
+            continue;
+        }
+
+        RecordHeader rh;
+        std::memcpy(&rh, p, sizeof(rh));
+        off += HEADER_SIZE;
+        if (rh.dataSize > end - off) {
+            logger::warn(std::format("record {:#010x} at offset {} runs past end of file; rest of file ignored", rh.formID, off - HEADER_SIZE));
+            return true;
+        }
+        if (!visit(rh, bytes.subspan(off, rh.dataSize)))
+            return false;
+        off += rh.dataSize;
+    }
+    return true;
+}
+
+// How compressed records are decoded. Streaming is what we use; Full is the old whole-payload
+// inflate, kept so the benchmark can compare the two.
+enum class InflateMode { Streaming, Full };
+
+// Per-record EDID extraction shared by both readers. `payload` is the raw record body; if the
+// record is compressed it is inflated into `scratch`, which is reused across records.
+// fn(sig, edid, localFormID) returns false to stop iteration.
+template <InflateMode Mode = InflateMode::Streaming, class Fn>
+bool visit_edid(const RecordHeader& rh, std::span<const uint8_t> payload, std::vector<uint8_t>& scratch, Fn& fn)
+{
+    const uint32_t sig = FOURCC(rh.sig[0], rh.sig[1], rh.sig[2], rh.sig[3]);
+    if (!RecordTypeBit(sig)) return true; // e.g. TES4
+
+    std::string_view edid;
+    if (rh.flags & RECORD_FLAG_COMPRESSED) {
+        if (payload.size() < 4) return true;
+        const uint32_t uncompressedSize = rd_le32(payload.data());
+        if constexpr (Mode == InflateMode::Streaming) {
+            edid = inflate_edid(payload.subspan(4), uncompressedSize, scratch);
+        }
+        else {
+            if (!inflate_zlib(payload.data() + 4, payload.size() - 4, uncompressedSize, scratch)) {
+                logger::debug(std::format("could not inflate record {:#010x}; skipped", rh.formID));
+                return true;
+            }
+            edid = parse_edid_from_record_bytes(scratch);
+        }
+    }
+    else {
+        edid = parse_edid_from_record_bytes(payload);
+    }
+
+    if (!edid.empty() && !fn(sig, edid, rh.formID)) {
+        logger::trace("callback indicated to cease iteration");
+        return false;
+    }
+    return true;
+}
+
+// Zero-copy reader: the plugin is mapped read-only and walked in place.
+template <InflateMode Mode = InflateMode::Streaming, class Fn>
+void scan_mapped(std::span<const uint8_t> bytes, Fn& fn, uint32_t types = ALL_RECORD_TYPE_BITS)
+{
+    std::vector<uint8_t> scratch;
+    auto visit = [&](const RecordHeader& rh, std::span<const uint8_t> payload) {
+        return visit_edid<Mode>(rh, payload, scratch, fn);
+    };
+    walk_records(bytes, visit, types);
+}
+
+// Stream reader: kept as a fallback for files that cannot be mapped. Same contract as
+// walk_records().
+template <class Visitor>
+bool process_range(std::ifstream& f, std::uint64_t end_offset, Visitor& visit, uint32_t types)
+{
+    std::vector<std::uint8_t> rdata;
+    while (true) {
+        auto here = static_cast<std::uint64_t>(f.tellg());
+        if (!f || here >= end_offset) break;
+
+        char tag[4];
+        if (!read_exact(f, tag, 4)) break;
+
+        if (std::memcmp(tag, "GRUP", 4) == 0) {
+            GroupHeader gh;
+            std::memcpy(gh.sig, tag, 4);
+            if (!read_exact(f, reinterpret_cast<char*>(&gh) + 4, sizeof(gh) - 4)) return true;
+
+            const std::uint64_t group_start = here;
+            const std::uint64_t group_end = group_start + gh.groupSize;
+            const std::uint64_t payload_beg = here + HEADER_SIZE;
+
+            // Top-level groups (type==0): label is record 4CC. Filter here.
+            if (gh.type == 0) {
+                uint32_t label = gh.label; // already little-endian 4CC
+                if (!(RecordTypeBit(label) & types)) {
+                    // Skip whole group
+                    f.seekg(group_end, std::ios::beg);
+                    continue;
+                }
+            }
+            else {
+                // Not top-level: if we don't need REFR/ACHR/etc, skip entirely.
+                f.seekg(group_end, std::ios::beg);
+                continue;
+            }
+
+            // Recurse into this group's payload
+            f.seekg(payload_beg, std::ios::beg);
+            if (!process_range(f, group_end, visit, types)) return false;
+
+            // Ensure we're positioned at the end of this group to continue
+            f.seekg(group_end, std::ios::beg);
+            continue;
+        }
+
+        // Record path: we already consumed 4 bytes of signature
+        RecordHeader rh{};
+        std::memcpy(rh.sig, tag, 4);
+        if (!read_exact(f, reinterpret_cast<char*>(&rh) + 4, sizeof(rh) - 4)) return true;
+
+        rdata.resize(rh.dataSize);
+        if (rh.dataSize && !read_exact(f, rdata.data(), rdata.size())) return true;
+        if (!visit(rh, std::span<const uint8_t>(rdata))) return false;
+    }
+    return true;
+}
+
+template <class Visitor>
+void walk_stream(const std::filesystem::path& path, Visitor& visit, uint32_t types = ALL_RECORD_TYPE_BITS)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        logger::warn(std::format("cannot access file {}", path.string()));
+        return;
+    }
+
+    // Whole file range
+    f.seekg(0, std::ios::end);
+    const auto file_end = static_cast<std::uint64_t>(f.tellg());
+    f.seekg(0, std::ios::beg);
+
+    // First thing is the TES4 record (not a GRUP) - parse it like any record:
+    // process_range() will handle it naturally because it treats both records and groups.
+    process_range(f, file_end, visit, types);
+}
+
+template <class Fn>
+void scan_stream(const std::filesystem::path& path, Fn& fn, uint32_t types = ALL_RECORD_TYPE_BITS)
+{
+    std::vector<uint8_t> scratch;
+    auto visit = [&](const RecordHeader& rh, std::span<const uint8_t> payload) {
+        return visit_edid(rh, payload, scratch, fn);
+    };
+    walk_stream(path, visit, types);
+}
+
+// Maps the file and walks it in place, or streams it if it can't be mapped.
+template <class Visitor>
+void walk_file(const std::filesystem::path& path, Visitor& visit, uint32_t types = ALL_RECORD_TYPE_BITS) {
+    MappedFile mapped(path);
+    if (mapped.ok()) {
+        walk_records(mapped.bytes(), visit, types);
+    }
+    else {
+        logger::debug(std::format("could not map {}; falling back to stream reader", path.string()));
+        walk_stream(path, visit, types);
+    }
+}
+
+// fn(sig, edid, localFormID) returns false to stop iteration, where sig is the record's 4CC as
+// read by FOURCC(). The edid view is only valid for the duration of the call. Only records of the
+// types in `types` are visited.
+template <class Fn>
+void scanFormsInFile(const std::filesystem::path& path, Fn&& fn, uint32_t types = ALL_RECORD_TYPE_BITS) {
+    std::vector<uint8_t> scratch;
+    auto visit = [&](const RecordHeader& rh, std::span<const uint8_t> payload) {
+        return visit_edid(rh, payload, scratch, fn);
+    };
+    walk_file(path, visit, types);
+}
+
+// The groups that hold catalogued records.
+constexpr uint32_t CATALOG_RECORD_TYPES = RecordTypeBit(FOURCC('A', 'R', 'M', 'O')) | RecordTypeBit(FOURCC('A', 'R', 'M', 'A'))
+    | RecordTypeBit(FOURCC('O', 'M', 'O', 'D')) | RecordTypeBit(FOURCC('R', 'A', 'C', 'E'));
+
+// visit_edid() that also fills `catalog`. Catalogued records need every subrecord, not just the
+// EDID, so those are inflated in full; everything else still goes through the streaming EDID
+// path.
+template <class Fn>
+bool visit_edid_and_catalog(const RecordHeader& rh, std::span<const uint8_t> payload, std::vector<uint8_t>& scratch, Fn& fn, RecordCatalog& catalog)
+{
+    const uint32_t sig = FOURCC(rh.sig[0], rh.sig[1], rh.sig[2], rh.sig[3]);
+    if (!RecordCatalog::catalogues(sig))
+        return visit_edid(rh, payload, scratch, fn);
+
+    std::span<const uint8_t> body = payload;
+    if (rh.flags & RECORD_FLAG_COMPRESSED) {
+        if (payload.size() < 4) return true;
+        if (!inflate_zlib(payload.data() + 4, payload.size() - 4, rd_le32(payload.data()), scratch)) {
+            logger::debug(std::format("could not inflate record {:#010x}; skipped", rh.formID));
+            return true;
+        }
+        body = scratch;
+    }
+    catalog.capture(sig, rh.formID, body);
+
+    const std::string_view edid = parse_edid_from_record_bytes(body);
+    if (!edid.empty() && !fn(sig, edid, rh.formID)) {
+        logger::trace("callback indicated to cease iteration");
+        return false;
+    }
+    return true;
+}
+
+// scanFormsInFile() that also fills `catalog` from the same pass.
+template <class Fn>
+void scanFormsAndCatalogInFile(const std::filesystem::path& path, Fn&& fn, RecordCatalog& catalog, uint32_t types = ALL_RECORD_TYPE_BITS) {
+    std::vector<uint8_t> scratch;
+    auto visit = [&](const RecordHeader& rh, std::span<const uint8_t> payload) {
+        return visit_edid_and_catalog(rh, payload, scratch, fn, catalog);
+    };
+    walk_file(path, visit, types);
+}
+
+// scanFormsAndCatalogInFile() over many plugins at once, with reads queued through
+// read_plugin_groups(). fn(file, sig, edid, localFormID) and catalogs[file] follow the same
+// per-plugin ordering and threading rules as read_plugin_groups().
+template <class Fn>
+size_t scanFormsAndCatalogInFiles(std::span<const std::filesystem::path> paths, Fn&& fn, std::span<RecordCatalog* const> catalogs,
+    size_t depth, size_t workers, uint32_t types = ALL_RECORD_TYPE_BITS)
+{
+    std::vector<std::vector<uint8_t>> scratch(paths.size());
+    return read_plugin_groups(paths, types, [&](size_t file, std::span<const uint8_t> group) {
+        auto report = [&fn, file](uint32_t sig, std::string_view edid, uint32_t localFormID) { return fn(file, sig, edid, localFormID); };
+        auto visit = [&](const RecordHeader& rh, std::span<const uint8_t> payload) {
+            return visit_edid_and_catalog(rh, payload, scratch[file], report, *catalogs[file]);
+        };
+        return walk_records(group, visit, types);
+    }, depth, workers);
+}
@@ -0,0 +1,183 @@
+#include "scscd.h"
+#include "plugin_prescan.h"
+#include "csv_scanner.h"
+#include "matswap_validity_report.h"
+#include "plugin_parser.h"
+#include "plugin_registry.h"
+#include "thread_pool.h"
+#include <unordered_set>
+
+static std::string lowercase(std::string_view s) {
+    std::string out(s);
+    std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return out;
+}
+
+// The game loads these whenever they are installed, whatever plugins.txt says.
+static const char* BASE_MASTERS[] = {
+    "Fallout4.esm", "DLCRobot.esm", "DLCworkshop01.esm", "DLCCoast.esm", "DLCworkshop02.esm",
+    "DLCworkshop03.esm", "DLCNukaWorld.esm", "DLCUltraHighResolution.esm",
+};
+
+// Appends the plugin names listed in a plugins.txt-style file: one per line, '#' comments. With
+// `starred`, only lines marked active with a leading '*' count.
+static bool read_plugin_list(const std::filesystem::path& path, bool starred, std::vector<std::string>& out) {
+    std::ifstream f(path);
+    if (!f) return false;
+    std::string line;
+    while (std::getline(f, line)) {
+        std::string name = trim(line);
+        if (name.empty() || name[0] == '#') continue;
+        if (starred) {
+            if (name[0] != '*') continue;
+            name.erase(0, 1);
+        }
+        out.push_back(std::move(name));
+    }
+    return true;
+}
+
+// The plugins the game will load: base masters, Creation Club content and the active entries of
+// plugins.txt, in that order, keeping only those present in Data. Without a plugins.txt, every
+// plugin in Data.
+static std::vector<std::string> predict_active_plugins() {
+    std::vector<std::string> names(std::begin(BASE_MASTERS), std::end(BASE_MASTERS));
+    read_plugin_list(GetGameRootDir() / "Fallout4.ccc", false, names);
+    const char* appdata = std::getenv("LOCALAPPDATA");
+    if (!appdata || !read_plugin_list(std::filesystem::path(appdata) / "Fallout4" / "plugins.txt", true, names)) {
+        logger::debug("no plugins.txt; pre-scanning every plugin in Data");
+        for (const char* ext : { ".esm", ".esp", ".esl" }) {
+            for (const std::string& path : scandir(GetDataDir(), ext, false))
+                names.push_back(std::filesystem::path(path).filename().string());
+        }
+    }
+
+    std::vector<std::string> plugins;
+    std::unordered_set<std::string> seen;
+    for (const std::string& name : names) {
+        std::string key = lowercase(name);
+        std::error_code ec;
+        if (!seen.contains(key) && std::filesystem::is_regular_file(DataPath(name), ec)) {
+            seen.insert(key);
+            plugins.push_back(std::move(key));
+        }
+    }
+    return plugins;
+}
+
+// The plugins a scoped lookup may search: each plugin the CSV files are named after, their
+// masters (transitively), and Fallout4.esm.
+static std::vector<std::string> predict_scoped_plugins(const EdidRequests& requests) {
+    std::vector<std::string> plugins{ "fallout4.esm" };
+    for (const auto& [plugin, edids] : requests) plugins.push_back(plugin);
+    std::unordered_set<std::string> seen(plugins.begin(), plugins.end());
+    std::vector<std::string> present;
+    for (size_t i = 0; i < plugins.size(); i++) {
+        std::vector<std::string> masters;
+        if (!read_plugin_masters(DataPath(plugins[i]), masters)) continue; // not installed
+        present.push_back(plugins[i]);
+        for (const std::string& m : masters) {
+            std::string key = lowercase(m);
+            if (seen.insert(key).second) plugins.push_back(std::move(key));
+        }
+    }
+    return present;
+}
+
+void PluginPrescan::Start(bool scoped)
+{
+    if (plugins_.valid()) return;
+    scoped_ = scoped;
+    std::promise<void> done;
+    plugins_ = done.get_future().share();
+    thread_ = std::jthread([this, scoped, done = std::move(done)]() mutable { run(scoped, std::move(done)); });
+}
+
+void PluginPrescan::run(bool scoped, std::promise<void> done)
+{
+    logger::trace("> PluginPrescan::run()");
+    auto start = std::chrono::steady_clock::now();
+    // The game is loading on the other cores; leave it half of them.
+    const size_t workers = std::max<size_t>(1, worker_count() / 2);
+    size_t scannedCount = 0;
+    try {
+        if (scoped) {
+            collect_occupation_edids(DataPath("F4SE\\Plugins\\scscd\\occupation"), requests_);
+            collect_tuple_edids(DataPath("F4SE\\Plugins\\scscd\\clothing"), requests_);
+            collect_exclusion_edids(DataPath("F4SE\\Plugins\\scscd\\exclusions"), requests_);
+        }
+        const std::filesystem::path cachePath = DataPath(EDID_CACHE_FILE);
+        cache_.load(cachePath);
+        predicted_ = scoped ? predict_scoped_plugins(requests_) : predict_active_plugins();
+
+        std::vector<PluginEdids> tables(predicted_.size());
+        std::vector<uint8_t> stale(predicted_.size(), 0);
+        parallel_for(predicted_.size(), [&](size_t i) {
+            tables[i].filename = predicted_[i];
+            stale[i] = PluginFingerprint::of(DataPath(predicted_[i]), tables[i].fingerprint) && !cache_.covers(tables[i]);
+        }, workers);
+
+        std::vector<PluginEdids*> toScan;
+        for (size_t i = 0; i < tables.size(); i++) {
+            if (stale[i]) toScan.push_back(&tables[i]);
+        }
+        ScanPluginEdids(toScan, workers);
+        scannedCount = toScan.size();
+        if (scannedCount > 0) {
+            // Saved now, while the game is still loading, rather than at data-ready.
+            std::vector<PluginEdids> scanned;
+            for (PluginEdids* p : toScan) scanned.push_back(std::move(*p));
+            cache_.save(cachePath, scanned);
+            for (PluginEdids& p : scanned) cache_.insert(std::move(p));
+        }
+    }
+    catch (const std::exception& e) {
+        logger::error(std::format("plugin pre-scan failed: {}", e.what()));
+    }
+    logger::info(std::format("pre-scan: {} plugins expected, {} scanned, {} from cache; {} ms",
+        predicted_.size(), scannedCount, predicted_.size() - scannedCount,
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()));
+    done.set_value();
+
+    try {
+        detail::textureIndex.build();
+    }
+    catch (const std::exception& e) {
+        logger::error(std::format("texture index pre-build failed: {}", e.what()));
+    }
+    logger::trace("< PluginPrescan::run()");
+}
+
+bool PluginPrescan::TakeCache(EdidCache& out)
+{
+    if (!plugins_.valid() || cacheTaken_) return false;
+    plugins_.wait();
+    cacheTaken_ = true;
+
+    const PluginRegistry& registry = PluginRegistry::Instance();
+    std::unordered_set<std::string_view> predicted(predicted_.begin(), predicted_.end());
+    size_t covered = 0;
+    for (uint16_t i = 0; i < registry.size(); i++) {
+        if (predicted.contains(registry[i].filename)) covered++;
+        else logger::debug(std::format("{} is active but wasn't pre-scanned", registry[i].filename));
+    }
+    if (scoped_) {
+        logger::info(std::format("pre-scan covered {} of {} active plugins (scoped lookup only needs some of them)", covered, registry.size()));
+    }
+    else {
+        logger::info(std::format("pre-scan covered {} of {} active plugins; {} pre-scanned plugins aren't active",
+            covered, registry.size(), predicted_.size() - covered));
+    }
+
+    out = std::move(cache_);
+    return true;
+}
+
+bool PluginPrescan::TakeRequests(EdidRequests& out)
+{
+    if (!plugins_.valid() || !scoped_ || requestsTaken_) return false;
+    plugins_.wait();
+    requestsTaken_ = true;
+    out = std::move(requests_);
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "scscd.h"
+#include "armor_index.h"
+#include "edid_cache.h"
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Startup work that doesn't need the game, done while the game loads instead of after it. Start()
+// is called from F4SEPlugin_Load and runs on its own thread: it loads the EDID cache, works out
+// which plugins the game is about to load, and scans the ones the cache doesn't cover yet, so that
+// by kGameDataReady the index only has to compose runtime form IDs. It then builds the BA2 texture
+// index. Every file is opened read-only and shared, so the game can still open it alongside us.
+//
+// The active plugins are predicted from plugins.txt, Fallout4.ccc and the base game masters (in
+// scoped mode: the plugins the CSV files name, their masters, and Fallout4.esm). A wrong guess
+// costs nothing but time: whatever the cache handed over doesn't cover is scanned at data-ready,
+// the same as without a pre-scan.
+class PluginPrescan {
+public:
+    static PluginPrescan& Instance()
+    {
+        static PluginPrescan s;
+        return s;
+    }
+
+    // Starts the pre-scan. Call at most once.
+    void Start(bool scoped);
+
+    // Waits for the plugin part of the pre-scan and moves its cache (the persisted tables plus
+    // the ones it scanned) into `out`. Returns false if there was no pre-scan, or the cache was
+    // already taken; load it from disk then. Call after PluginRegistry::Build(), which the
+    // prediction is checked against.
+    bool TakeCache(EdidCache& out);
+
+    // In scoped mode, waits and moves the EDIDs the CSV files request into `out`, as collected
+    // by the pre-scan. Same return as TakeCache().
+    bool TakeRequests(EdidRequests& out);
+
+private:
+    PluginPrescan() {}
+    void run(bool scoped, std::promise<void> done);
+
+    std::jthread thread_;
+    std::shared_future<void> plugins_; // ready once everything but the texture index is done
+    EdidCache cache_;
+    EdidRequests requests_;
+    std::vector<std::string> predicted_; // lowercase
+    bool scoped_{ false }, cacheTaken_{ false }, requestsTaken_{ false };
+};
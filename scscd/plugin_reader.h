@@ -1,7 +1,31 @@
 #pragma once
 
 #include <string>
-#include <functional>
+#include <unordered_map>
 #include "_fallout.h"
+#include "record_source.h"
 
-void IndexOneTESFile(RE::TESFile* f, const std::function<bool (RE::TESFile* file, RE::ENUM_FORM_ID formType, const std::string& edid, uint32_t formID)>& cb);
+// Lists EDIDs through the engine's own plugin reader (TESFile::OpenTES / NextForm / GetTESChunk).
+// The engine keeps one cursor per TESFile, so plugins are read one at a time, and only from the
+// thread that handles the game's load messages.
+class EngineRecordSource : public RecordSource {
+    std::unordered_map<std::string, RE::TESFile*> files_; // by lowercase file name; active plugins only
+    bool probe_;
+
+public:
+    // probe: before each scan, also walk the whole plugin once more and trace every form and the
+    // first few TES4 chunks. Only useful with bDebugLog on, and it doubles the cost of a scan.
+    explicit EngineRecordSource(bool probe = false);
+
+    const char* name() const override { return "engine"; }
+    bool concurrent() const override { return false; }
+    bool scan(const std::string& plugin, const RecordVisitor& fn, uint32_t types = ALL_RECORD_TYPE_BITS) override;
+};
+
+// Whether SCSCD_RECORD_SOURCE=engine asks for EngineRecordSource in place of our own reader.
+// Whoever builds the EDID index must then do it on the thread that handles the load messages.
+bool EngineRecordSourceRequested();
+
+// Developer aid: runs the engine and file sources over every active plugin and logs how they
+// compare (see compare_record_sources).
+void CompareRecordSources(bool probe);
@@ -0,0 +1,80 @@
+#include "scscd.h"
+#include "plugin_registry.h"
+#include "plugin_parser.h"
+#include "thread_pool.h"
+#include <algorithm>
+
+static std::string lowercase(std::string_view s) {
+    std::string out(s);
+    std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return out;
+}
+
+void PluginRegistry::Build()
+{
+    logger::trace("> PluginRegistry::Build()");
+    auto start = std::chrono::steady_clock::now();
+    plugins_.clear();
+    byName_.clear();
+    byCompileIndex_.fill(NONE);
+    bySmallIndex_.assign(0x1000, NONE);
+
+    auto* dh = RE::TESDataHandler::GetSingleton();
+    for (auto* f : dh->compiledFileCollection.files) {
+        if (!f || !f->IsActive()) continue;
+        const uint8_t index = f->GetCompileIndex();
+        byCompileIndex_[index] = (uint16_t)plugins_.size();
+        plugins_.push_back({ .file = f, .filename = lowercase(f->filename),
+            .base = uint32_t(index) << 24, .mask = 0x00FFFFFFu, .light = false });
+    }
+    for (auto* f : dh->compiledFileCollection.smallFiles) {
+        if (!f || !f->IsActive()) continue;
+        const uint16_t index = f->GetSmallFileCompileIndex() & 0x0FFFu;
+        bySmallIndex_[index] = (uint16_t)plugins_.size();
+        plugins_.push_back({ .file = f, .filename = lowercase(f->filename),
+            .base = 0xFE000000u | (uint32_t(index) << 12), .mask = 0x00000FFFu, .light = true });
+    }
+    for (size_t i = 0; i < plugins_.size(); i++)
+        byName_.emplace(plugins_[i].filename, (uint16_t)i);
+
+    // Master lists come from the plugin headers; each is a small read of its own file.
+    std::vector<std::vector<std::string>> names(plugins_.size());
+    parallel_for(plugins_.size(), [&](size_t i) {
+        if (!read_plugin_masters(DataPath(plugins_[i].file->filename), names[i]))
+            logger::warn(std::format("could not read masters of {}", plugins_[i].file->filename));
+    });
+    for (size_t i = 0; i < plugins_.size(); i++) {
+        for (const std::string& name : names[i])
+            plugins_[i].masters.push_back(find(name));
+    }
+
+    logger::info(std::format("plugin registry: {} active plugins; {} ms", plugins_.size(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()));
+    logger::trace("< PluginRegistry::Build()");
+}
+
+uint16_t PluginRegistry::find(std::string_view filename) const
+{
+    auto it = byName_.find(lowercase(filename));
+    return it == byName_.end() ? NONE : it->second;
+}
+
+uint32_t PluginRegistry::resolve(uint16_t ordinal, uint32_t fileFormID) const
+{
+    const Plugin& p = plugins_[ordinal];
+    const size_t owner = fileFormID >> 24;
+    if (owner >= p.masters.size()) return runtimeID(ordinal, fileFormID);
+    if (p.masters[owner] == NONE) return 0;
+    return runtimeID(p.masters[owner], fileFormID);
+}
+
+std::optional<FormKey> PluginRegistry::locate(uint32_t runtimeID) const
+{
+    uint16_t ordinal;
+    if ((runtimeID >> 24) == 0xFE)
+        ordinal = bySmallIndex_.empty() ? NONE : bySmallIndex_[(runtimeID >> 12) & 0x0FFFu];
+    else
+        ordinal = byCompileIndex_[runtimeID >> 24];
+    if (ordinal == NONE) return std::nullopt;
+    return FormKey{ ordinal, runtimeID & plugins_[ordinal].mask };
+}
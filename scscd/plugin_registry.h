@@ -0,0 +1,77 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "_fallout.h"
+#include "logger.h"
+
+// A form named by the plugin it comes from and its object ID (the low 24 bits of a form ID, or
+// 12 for a light plugin), independent of where that plugin sits in the load order.
+struct FormKey {
+    uint16_t plugin;
+    uint32_t objectID;
+
+    bool operator==(const FormKey&) const = default;
+};
+
+// The active plugins, numbered in load order (full plugins, then light ones), with everything
+// needed to turn a plugin-relative form ID into a runtime one: the runtime base of each plugin's
+// form IDs and the plugins its masters are this session. Plugin files and caches only ever hold
+// plugin-relative IDs; runtime IDs are composed here, at the point where the engine needs them.
+class PluginRegistry
+{
+public:
+    static constexpr uint16_t NONE = 0xFFFF;
+
+    struct Plugin {
+        RE::TESFile* file;
+        std::string filename;          // lowercase
+        uint32_t base;                 // compile index << 24, or 0xFE000000 | small index << 12
+        uint32_t mask;                 // object ID bits: 0x00FFFFFF, or 0x00000FFF if light
+        std::vector<uint16_t> masters; // MAST order; NONE for masters that aren't active
+        bool light;
+    };
+
+    static PluginRegistry& Instance()
+    {
+        static PluginRegistry s;
+        return s;
+    }
+
+    // Call this ONCE at startup, after the game has loaded its plugins and before anything asks
+    // for form IDs. Read-only afterwards, so it is safe to use from any thread.
+    void Build();
+
+    size_t size() const { return plugins_.size(); }
+    const Plugin& operator[](uint16_t ordinal) const { return plugins_[ordinal]; }
+
+    // Ordinal of the plugin with this file name (any case), or NONE if it isn't active.
+    uint16_t find(std::string_view filename) const;
+
+    uint32_t runtimeID(uint16_t ordinal, uint32_t objectID) const
+    {
+        const Plugin& p = plugins_[ordinal];
+        return p.base | (objectID & p.mask);
+    }
+    uint32_t runtimeID(FormKey key) const { return runtimeID(key.plugin, key.objectID); }
+
+    // Runtime ID of a form ID as stored in plugin `ordinal`'s file: its top byte picks the owner
+    // from the plugin's master list, and anything past the end of the list is the plugin itself.
+    // 0 if the owning master isn't active.
+    uint32_t resolve(uint16_t ordinal, uint32_t fileFormID) const;
+
+    // The plugin and object ID a runtime form ID refers to, if its plugin is active.
+    std::optional<FormKey> locate(uint32_t runtimeID) const;
+
+private:
+    PluginRegistry() { byCompileIndex_.fill(NONE); }
+
+    std::vector<Plugin> plugins_;
+    std::unordered_map<std::string, uint16_t> byName_;
+    std::array<uint16_t, 256> byCompileIndex_{};
+    std::vector<uint16_t> bySmallIndex_;
+};
@@ -0,0 +1,78 @@
+#include "record_source.h"
+#include "plugin_parser.h"
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+
+bool FileRecordSource::scan(const std::string& plugin, const RecordVisitor& fn, uint32_t types)
+{
+    const std::filesystem::path path = dataDir_ / plugin;
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path, ec)) {
+        logger::warn(std::format("cannot access file {}", path.string()));
+        return false;
+    }
+    scanFormsInFile(path, fn, types);
+    return true;
+}
+
+namespace {
+    using Record = std::tuple<uint32_t, uint32_t, std::string>; // sig, local form ID, edid
+
+    std::string describe(const Record& r) {
+        char sig[5]{};
+        const uint32_t v = std::get<0>(r);
+        std::memcpy(sig, &v, 4);
+        const std::string& edid = std::get<2>(r);
+        return std::format("{} {:#010x} {}{}", sig, std::get<1>(r), edid.substr(0, 80), edid.size() > 80 ? "..." : "");
+    }
+}
+
+bool compare_record_sources(std::span<RecordSource* const> sources, const std::vector<std::string>& plugins, const char* label)
+{
+    if (sources.empty()) return true;
+    struct Totals { double ms{ 0 }; size_t records{ 0 }; size_t failed{ 0 }; };
+    std::vector<Totals> totals(sources.size());
+    size_t mismatchedPlugins = 0;
+
+    for (size_t i = 0; i < plugins.size(); i++) {
+        std::vector<std::vector<Record>> seen(sources.size());
+        for (size_t k = 0; k < sources.size(); k++) {
+            const size_t s = (i + k) % sources.size();
+            std::vector<Record>& out = seen[s];
+            auto start = std::chrono::steady_clock::now();
+            const bool ok = sources[s]->scan(plugins[i], [&out](uint32_t sig, std::string_view edid, uint32_t localID) {
+                out.emplace_back(sig, localID, std::string(edid));
+                return true;
+            });
+            totals[s].ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            totals[s].records += out.size();
+            totals[s].failed += !ok;
+        }
+
+        for (auto& records : seen) std::sort(records.begin(), records.end());
+        bool agreed = true;
+        for (size_t s = 1; s < sources.size(); s++) {
+            if (seen[s] == seen[0]) continue;
+            agreed = false;
+            std::vector<Record> onlyFirst, onlyOther;
+            std::set_difference(seen[0].begin(), seen[0].end(), seen[s].begin(), seen[s].end(), std::back_inserter(onlyFirst));
+            std::set_difference(seen[s].begin(), seen[s].end(), seen[0].begin(), seen[0].end(), std::back_inserter(onlyOther));
+            logger::warn(std::format("{}: {} reported {} records, {} reported {}; {} only from {}, {} only from {}",
+                plugins[i], sources[0]->name(), seen[0].size(), sources[s]->name(), seen[s].size(),
+                onlyFirst.size(), sources[0]->name(), onlyOther.size(), sources[s]->name()));
+            for (size_t n = 0; n < std::min<size_t>(onlyFirst.size(), 5); n++)
+                logger::debug(std::format("  only from {}: {}", sources[0]->name(), describe(onlyFirst[n])));
+            for (size_t n = 0; n < std::min<size_t>(onlyOther.size(), 5); n++)
+                logger::debug(std::format("  only from {}: {}", sources[s]->name(), describe(onlyOther[n])));
+        }
+        mismatchedPlugins += !agreed;
+    }
+
+    logger::info(std::format("record source comparison ({}): {} plugins, {} disagreed", label, plugins.size(), mismatchedPlugins));
+    for (size_t s = 0; s < sources.size(); s++) {
+        logger::info(std::format("  {:>8}: {:.1f} ms, {} records, {} plugins unreadable",
+            sources[s]->name(), totals[s].ms, totals[s].records, totals[s].failed));
+    }
+    return mismatchedPlugins == 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "plugin_format.h"
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// fn(sig, edid, localFormID) returns false to stop. sig is the record's 4CC as read by FOURCC(),
+// and the form ID is exactly as stored in the plugin. The edid view is only valid for the
+// duration of the call.
+using RecordVisitor = std::function<bool(uint32_t sig, std::string_view edid, uint32_t localFormID)>;
+
+// Something that can list the EDIDs in a plugin. There are two: our own reader over the files on
+// disk (FileRecordSource, below) and the engine's TESFile reader (EngineRecordSource, in
+// plugin_reader.h). They visit the same records, so callers can use either and the two can be
+// timed against each other on the same plugins.
+class RecordSource {
+public:
+    virtual ~RecordSource() = default;
+
+    virtual const char* name() const = 0;
+
+    // Whether scan() may be called for different plugins from several threads at once.
+    virtual bool concurrent() const = 0;
+
+    // Visits every record of the types in `types` (a RecordTypeBit mask) that has an EDID, in
+    // file order. `plugin` is the file name as it appears in the load order. Returns false if
+    // the plugin could not be read at all.
+    virtual bool scan(const std::string& plugin, const RecordVisitor& fn, uint32_t types = ALL_RECORD_TYPE_BITS) = 0;
+};
+
+// Reads the plugin files directly with the parser in plugin_parser.h.
+class FileRecordSource : public RecordSource {
+    std::filesystem::path dataDir_;
+
+public:
+    explicit FileRecordSource(std::filesystem::path dataDir) : dataDir_(std::move(dataDir)) {}
+
+    const char* name() const override { return "file"; }
+    bool concurrent() const override { return true; }
+    bool scan(const std::string& plugin, const RecordVisitor& fn, uint32_t types = ALL_RECORD_TYPE_BITS) override;
+};
+
+// Runs every source over every plugin, logs how long each took and whether they reported the
+// same records (signature, local form ID and EDID), and returns true if they all agreed. The
+// order the sources run in is rotated from one plugin to the next, so no source is always the
+// one that finds the file in a warm page cache.
+bool compare_record_sources(std::span<RecordSource* const> sources, const std::vector<std::string>& plugins, const char* label);
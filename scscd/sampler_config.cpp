@@ -89,6 +89,13 @@ bool ArmorIndex::SamplerConfig::load(std::filesystem::path &path, bool noisy) {
     allowNSFWChoices    = LoadFromIni(ini, "bAllowNSFW",           noisy ? false : allowNSFWChoices,    noisy);
     allowNudity         = LoadFromIni(ini, "bAllowNudity",         noisy ? false : allowNudity,         noisy);
     replaceArmor        = LoadFromIni(ini, "bReplaceArmor",        noisy ? false : replaceArmor,        noisy);
+    scopedEdidLookup    = LoadFromIni(ini, "bScopedEdidLookup",    noisy ? false : scopedEdidLookup,    noisy);
+    discoverOmods       = LoadFromIni(ini, "bDiscoverOmods",       noisy ? false : discoverOmods,       noisy);
+    prescanPlugins      = LoadFromIni(ini, "bPrescanPlugins",      noisy ? true  : prescanPlugins,      noisy);
+    parallelStartup     = LoadFromIni(ini, "bParallelStartup",     noisy ? true  : parallelStartup,     noisy);
+    textureIndexFromRecords = LoadFromIni(ini, "bTextureIndexFromRecords", noisy ? true : textureIndexFromRecords, noisy);
+    engineMaterialReads = LoadFromIni(ini, "bEngineMaterialReads", noisy ? false : engineMaterialReads, noisy);
+    validateOmodsInBackground = LoadFromIni(ini, "bValidateOmodsInBackground", noisy ? true : validateOmodsInBackground, noisy);
     for (uint32_t slot = 30; slot < 62; slot++) {
         // by default, all slots have zero chance to be filled. This way, no configuration == no mod behavior.
         fillSlotChanceM[slot2bit(slot)] = LoadFromIni(ini, std::format("iMaleFillSlotChance{}",   slot), noisy ? 0 : fillSlotChanceM[slot2bit(slot)], noisy);
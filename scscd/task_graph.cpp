@@ -0,0 +1,135 @@
+#include "task_graph.h"
+#include "logger.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <format>
+#include <mutex>
+#include <stdexcept>
+
+TaskGraph::Stage TaskGraph::add(std::string name, std::function<void()> fn, std::initializer_list<Stage> after)
+{
+    const Stage stage = nodes_.size();
+    for (Stage dep : after) {
+        if (dep >= stage) throw std::invalid_argument(std::format("stage {} runs after a stage that doesn't exist yet", name));
+    }
+    nodes_.push_back({ std::move(name), std::move(fn), {}, after.size() });
+    for (Stage dep : after) nodes_[dep].dependents.push_back(stage);
+    return stage;
+}
+
+void TaskGraph::run(size_t workers)
+{
+    using clock = std::chrono::steady_clock;
+    auto ms = [](clock::duration d) { return std::chrono::duration_cast<std::chrono::milliseconds>(d).count(); };
+    if (nodes_.empty()) return;
+    const size_t threads = std::min(std::max<size_t>(workers, 1), nodes_.size());
+
+    struct Queue {
+        std::mutex m;
+        std::deque<Stage> stages;
+    };
+    std::vector<Queue> queues(threads);
+    std::vector<std::atomic<size_t>> waiting(nodes_.size());
+    std::vector<std::atomic<bool>> failed(nodes_.size()); // set before the stage's dependents are queued
+    std::mutex m;
+    std::condition_variable wake;
+    size_t ready = 0;                   // queued and not yet taken
+    size_t remaining = nodes_.size();   // not yet finished
+    std::exception_ptr error;
+    clock::duration busy{};
+    const auto start = clock::now();
+
+    auto push = [&](size_t worker, Stage stage) {
+        {
+            std::lock_guard lock(queues[worker].m);
+            queues[worker].stages.push_back(stage);
+        }
+        std::lock_guard lock(m);
+        ready++;
+        wake.notify_one();
+    };
+    // Newest from our own queue, else the oldest from anyone else's.
+    auto take = [&](size_t worker, Stage& stage) {
+        for (size_t i = 0; i < threads; i++) {
+            Queue& q = queues[(worker + i) % threads];
+            std::lock_guard lock(q.m);
+            if (q.stages.empty()) continue;
+            if (i == 0) { stage = q.stages.back(); q.stages.pop_back(); }
+            else { stage = q.stages.front(); q.stages.pop_front(); }
+            std::lock_guard counts(m);
+            ready--;
+            return true;
+        }
+        return false;
+    };
+    auto execute = [&](size_t worker, Stage stage) {
+        Node& node = nodes_[stage];
+        const auto began = clock::now();
+        if (failed[stage]) {
+            logger::warn(std::format("skipped stage {}: a stage it runs after failed", node.name));
+        }
+        else {
+            try {
+                node.fn();
+            }
+            catch (const std::exception& e) {
+                logger::error(std::format("stage {} failed: {}", node.name, e.what()));
+                failed[stage] = true;
+                std::lock_guard lock(m);
+                if (!error) error = std::current_exception();
+            }
+            catch (...) {
+                logger::error(std::format("stage {} failed", node.name));
+                failed[stage] = true;
+                std::lock_guard lock(m);
+                if (!error) error = std::current_exception();
+            }
+            const auto took = clock::now() - began;
+            logger::info(std::format("completed stage {} in {} ms (started at +{} ms)", node.name, ms(took), ms(began - start)));
+            std::lock_guard lock(m);
+            busy += took;
+        }
+        for (Stage next : node.dependents) {
+            if (failed[stage]) failed[next] = true;
+            if (--waiting[next] == 0) push(worker, next);
+        }
+        std::lock_guard lock(m);
+        if (--remaining == 0) wake.notify_all();
+    };
+
+    size_t seeded = 0;
+    for (Stage s = 0; s < nodes_.size(); s++) {
+        waiting[s] = nodes_[s].dependencies;
+        if (nodes_[s].dependencies == 0) {
+            queues[seeded++ % threads].stages.push_back(s);
+            ready++;
+        }
+    }
+
+    {
+        std::vector<std::jthread> pool;
+        pool.reserve(threads);
+        for (size_t w = 0; w < threads; w++) {
+            pool.emplace_back([&, w] {
+                while (true) {
+                    Stage stage;
+                    if (take(w, stage)) {
+                        execute(w, stage);
+                        continue;
+                    }
+                    std::unique_lock lock(m);
+                    wake.wait(lock, [&] { return remaining == 0 || ready > 0; });
+                    if (remaining == 0) return;
+                }
+            });
+        }
+        // jthread joins on destruction
+    }
+
+    logger::info(std::format("ran {} startup stages in {} ms on {} threads ({} ms if run one after another)",
+        nodes_.size(), ms(clock::now() - start), threads, ms(busy)));
+    if (error) std::rethrow_exception(error);
+}
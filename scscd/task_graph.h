@@ -0,0 +1,38 @@
+#pragma once
+
+#include "thread_pool.h"
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// A fixed set of startup stages and what each one has to wait for, run on a small work-stealing
+// pool. Every worker keeps its own queue of ready stages and takes the newest one from it, so a
+// stage's follow-ups stay on the thread that has its data warm; an idle worker takes the oldest
+// stage from someone else's queue instead. A stage becomes ready once everything it runs after
+// has finished.
+//
+// Each stage's start and duration are logged, along with a summary of how long the whole graph
+// took against the sum of its stages.
+class TaskGraph {
+public:
+    using Stage = size_t;
+
+    // Adds a stage that runs `fn` once every stage in `after` has finished. `after` may only name
+    // stages that were already added, which keeps the graph free of cycles.
+    Stage add(std::string name, std::function<void()> fn, std::initializer_list<Stage> after = {});
+
+    // Runs every stage on up to `workers` threads and returns once they are all done; the calling
+    // thread only waits. If a stage throws, the stages that depend on it are skipped, the others
+    // still run, and the first exception is rethrown here.
+    void run(size_t workers = worker_count());
+
+private:
+    struct Node {
+        std::string name;
+        std::function<void()> fn;
+        std::vector<Stage> dependents;
+        size_t dependencies{ 0 };
+    };
+    std::vector<Node> nodes_;
+};
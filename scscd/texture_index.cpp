@@ -1,57 +1,368 @@
 #include "texture_index.h"
+#include "ba2_archive.h"
 #include "csv_scanner.h"
 #include "benchmark.h"
+#include "async_io.h"
+#include "plugin_format.h"
+#include "thread_pool.h"
+#include <fstream>
 
-struct BA2Header {
-    char     magic[4];        // "BTDX" (some docs flip to "BDTX")
-    uint32_t version;         // 1
-    char     type[4];         // "GNRL" or "DX10"
-    uint32_t fileCount;
-    uint64_t nameTableOffset; // absolute file offset of the name table
-};
+static inline char NormalizeChar(char c) {
+    if (c == '\\') return '/';
+    return (char)std::tolower((unsigned char)c);
+}
+
+uint64_t TextureIndex::hash(std::string_view path)
+{
+    uint64_t h = 1469598103934665603ull; // FNV-1a over normalized bytes
+    for (char c : path) {
+        h ^= (unsigned char)NormalizeChar(c);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
 
-static inline std::string NormalizeLowerSlash(std::string s) {
-    std::replace(s.begin(), s.end(), '\\', '/');
-    std::transform(s.begin(), s.end(), s.begin(),
-        [](unsigned char c) { return (char)std::tolower(c); });
-    return s;
+// Folds more bytes into an FNV-1a hash, as they are.
+static uint64_t fnv1a_fold(uint64_t h, const void* data, size_t n)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
 }
 
-bool ReadBA2NameTable(const std::filesystem::path& ba2, std::unordered_set<std::string>& outNames)
+uint64_t TextureIndex::recordKey(uint32_t dirHash, uint32_t fileHash, uint32_t ext)
 {
-    std::ifstream f(ba2, std::ios::binary);
-    if (!f) return false;
+    // Both hashes are already well mixed; the extension is folded in multiplicatively.
+    return ((uint64_t)dirHash << 32 | fileHash) ^ (ext * 0x9E3779B97F4A7C15ull);
+}
 
-    BA2Header h{};
-    if (!f.read(reinterpret_cast<char*>(&h), sizeof(h))) return false;
-    if (std::string_view(h.magic, 4) != "BTDX") return false; // be strict; change if you need to accept both
+uint64_t TextureIndex::recordKey(std::string_view path)
+{
+    const BA2PathHashes h = ba2_path_hashes(path);
+    return recordKey(h.dir, h.file, h.ext);
+}
 
-    // Seek to name table and read fileCount entries: [u16 length][bytes...]
-    f.seekg(static_cast<std::streamoff>(h.nameTableOffset), std::ios::beg);
-    outNames.reserve(outNames.size() + h.fileCount);
+// Rough heap cost of one path in an unordered_set<std::string>: the node (next pointer, cached
+// hash, string), a bucket slot, and the characters themselves once they're past the small
+// string buffer. Only used to put the compact index's size in perspective.
+static size_t string_set_entry_bytes(size_t length) {
+    size_t bytes = 2 * sizeof(void*) + sizeof(std::string) + sizeof(void*);
+    if (length > 15) bytes += (length + 16) & ~size_t(15);
+    return bytes;
+}
 
-    for (uint32_t i = 0; i < h.fileCount; ++i) {
-        uint16_t len = 0;
-        if (!f.read(reinterpret_cast<char*>(&len), sizeof(len))) return false;
+// A name table is fileCount entries of [u16 length][bytes...], packed back to back. Calls fn with
+// each name in place.
+template <typename Fn>
+static bool ParseBA2NameTable(std::span<const uint8_t> table, uint32_t fileCount, Fn&& fn)
+{
+    size_t off = 0;
+    for (uint32_t i = 0; i < fileCount; ++i) {
+        if (table.size() - off < sizeof(uint16_t)) return false;
+        const uint16_t len = rd_le16(table.data() + off);
+        off += sizeof(uint16_t);
         if (len == 0) { continue; }
+        if (table.size() - off < len) return false;
 
-        std::string s(len, '\0');
-        if (!f.read(s.data(), len)) return false;
+        std::string_view s(reinterpret_cast<const char*>(table.data() + off), len);
+        off += len;
 
         // Some archives may include a trailing NUL; if present, strip it.
-        if (!s.empty() && s.back() == '\0') s.pop_back();
+        if (!s.empty() && s.back() == '\0') s.remove_suffix(1);
+
+        //logger::trace(std::format("  : SEEN TEXTURE {}", s));
+        fn(s);
+    }
+    return true;
+}
 
-        std::string path = NormalizeLowerSlash(std::move(s));
-        //logger::trace(std::format("  : SEEN TEXTURE {}", path));
-        outNames.insert(path);
+// Calls fn(key) with the record key of each of the fileCount records that start the table.
+template <typename Fn>
+static bool ParseBA2Records(std::span<const uint8_t> table, bool dx10, uint32_t fileCount, Fn&& fn)
+{
+    size_t off = 0;
+    for (uint32_t i = 0; i < fileCount; ++i) {
+        const size_t fixed = dx10 ? BA2_DX10_RECORD : BA2_GNRL_RECORD;
+        if (table.size() - off < fixed) return false;
+        const uint8_t* r = table.data() + off;
+        fn(TextureIndex::recordKey(rd_le32(r + 8), rd_le32(r), rd_le32(r + 4)));
+        off += fixed;
+        if (dx10) {
+            const size_t chunks = r[13];
+            if ((table.size() - off) / BA2_DX10_CHUNK < chunks) return false;
+            off += chunks * BA2_DX10_CHUNK;
+        }
     }
     return true;
 }
 
-bool TextureIndex::contains(const std::string& path)
+// What one archive contributed. Each is filled by whichever worker parsed that archive, so no
+// two threads ever touch the same one.
+struct BA2Shard {
+    std::vector<uint64_t> keys;                          // sorted and unique once complete
+    std::vector<std::pair<uint64_t, std::string>> named; // only when keeping names
+    size_t stringSetBytes{ 0 };                          // only when names were read
+    size_t mismatches{ 0 };                              // record keys the names disagree with
+};
+
+// Reads every archive's entries at once. For each archive the header and then one whole table are
+// queued on one AsyncReader, so the disk sees every archive's requests together instead of a
+// stream of tiny reads one archive at a time, and the tables are parsed in place on the reader's
+// workers as they arrive. Each archive's keys go into its own shard, sorted there, so nothing is
+// shared until the shards are merged.
+//
+// With `fromRecords`, that table is the record table right after the header, and the keys are
+// the archive's own hashes; the name table at the end is only read for archives whose record
+// layout we don't know, or to check the keys when verifying. Otherwise the name table is read
+// and each name is hashed.
+static void ReadBA2Entries(const std::vector<std::string>& ba2s, bool fromRecords, bool verify, std::vector<BA2Shard>& shards)
+{
+    shards.assign(ba2s.size(), {});
+    AsyncReader reader;
+    auto finish = [](BA2Shard& shard) {
+        std::sort(shard.keys.begin(), shard.keys.end());
+        shard.keys.erase(std::unique(shard.keys.begin(), shard.keys.end()), shard.keys.end());
+    };
+    // Queues a read of archive i's name table, then parses it. `records` holds the keys already
+    // read from its record table, if any, to check the names against.
+    auto readNames = [&](size_t i, int file, const BA2Header& h, uint64_t size, std::vector<uint64_t> records) {
+        reader.read(file, h.nameTableOffset, size_t(size - h.nameTableOffset),
+            [&, i, fileCount = h.fileCount, records = std::move(records)](std::vector<uint8_t> table) {
+            BA2Shard& local = shards[i];
+            local.keys.reserve(fileCount);
+            const bool complete = ParseBA2NameTable(table, fileCount, [&](std::string_view name) {
+                const uint64_t key = fromRecords ? TextureIndex::recordKey(name) : TextureIndex::hash(name);
+                local.keys.push_back(key);
+                local.stringSetBytes += string_set_entry_bytes(name.size());
+                if (verify && !fromRecords) {
+                    std::string normalized(name);
+                    std::transform(normalized.begin(), normalized.end(), normalized.begin(), NormalizeChar);
+                    local.named.emplace_back(key, std::move(normalized));
+                }
+                if (!records.empty() && (local.keys.size() > records.size() || records[local.keys.size() - 1] != key)) {
+                    if (local.mismatches++ == 0)
+                        logger::warn(std::format("BA2 {}: record hashes don't match name {}", ba2s[i], name));
+                }
+            });
+            if (!complete)
+                logger::warn(std::format("BA2 {} has a truncated name table", ba2s[i]));
+            if (!records.empty()) local.keys = std::move(records); // verifying: the records are the index
+            finish(local);
+        });
+    };
+
+    for (size_t i = 0; i < ba2s.size(); i++) {
+        const std::string& ba2 = ba2s[i];
+        logger::debug(std::format("scanning BA2 {}", ba2));
+        const int file = reader.open(ba2);
+        if (file < 0) {
+            logger::warn(std::format("cannot access file {}", ba2));
+            continue;
+        }
+        const uint64_t size = reader.size(file);
+        reader.read(file, 0, sizeof(BA2Header), [&, i, file, size](std::vector<uint8_t> head) {
+            BA2Header h{};
+            if (head.empty()) return;
+            std::memcpy(&h, head.data(), sizeof(h));
+            if (std::string_view(h.magic, 4) != "BTDX") return; // be strict; change if you need to accept both
+            if (h.fileCount == 0) return;
+            const bool hasNames = h.nameTableOffset > sizeof(BA2Header) && h.nameTableOffset < size;
+            const bool dx10 = std::string_view(h.type, 4) == "DX10";
+            const bool knownLayout = ba2_known_version(h.version)
+                && (dx10 || std::string_view(h.type, 4) == "GNRL");
+
+            if (!fromRecords || !knownLayout) {
+                if (hasNames) readNames(i, file, h, size, {});
+                return;
+            }
+            // The record table runs up to the name table; without one, only GNRL's length is known.
+            const uint64_t end = hasNames ? h.nameTableOffset : dx10 ? 0 : sizeof(BA2Header) + uint64_t(h.fileCount) * BA2_GNRL_RECORD;
+            if (end <= sizeof(BA2Header) || end > size) {
+                logger::warn(std::format("BA2 {}: can't tell where its records end", ba2s[i]));
+                return;
+            }
+            reader.read(file, sizeof(BA2Header), size_t(end - sizeof(BA2Header)), [&, i, file, size, h, hasNames, dx10](std::vector<uint8_t> table) {
+                BA2Shard& local = shards[i];
+                local.keys.reserve(h.fileCount);
+                if (!ParseBA2Records(table, dx10, h.fileCount, [&](uint64_t key) { local.keys.push_back(key); }))
+                    logger::warn(std::format("BA2 {} has a truncated record table", ba2s[i]));
+                if (verify && hasNames && !local.keys.empty()) readNames(i, file, h, size, std::exchange(local.keys, {}));
+                else finish(local);
+            });
+        });
+    }
+    reader.wait();
+}
+
+// Merges sorted, unique runs of keys into one sorted, unique array: pairs of runs are merged side
+// by side, halving the number of runs each round.
+static std::vector<uint64_t> MergeRuns(std::vector<std::span<const uint64_t>> runs)
+{
+    std::erase_if(runs, [](std::span<const uint64_t> run) { return run.empty(); });
+    std::vector<std::vector<uint64_t>> merged;
+    if (runs.size() == 1) merged.emplace_back(runs[0].begin(), runs[0].end());
+    while (runs.size() > 1) {
+        std::vector<std::vector<uint64_t>> next((runs.size() + 1) / 2);
+        parallel_for(next.size(), [&](size_t i) {
+            if (2 * i + 1 == runs.size()) {
+                next[i].assign(runs[2 * i].begin(), runs[2 * i].end());
+                return;
+            }
+            std::span<const uint64_t> a = runs[2 * i], b = runs[2 * i + 1];
+            next[i].reserve(a.size() + b.size());
+            std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(next[i]));
+            next[i].erase(std::unique(next[i].begin(), next[i].end()), next[i].end());
+        });
+        merged = std::move(next); // the runs of the round before are only needed until here
+        runs.assign(merged.begin(), merged.end());
+    }
+    if (merged.empty()) return {};
+    merged[0].shrink_to_fit();
+    return std::move(merged[0]);
+}
+
+namespace {
+    constexpr uint32_t TEXTURE_CACHE_MAGIC = FOURCC('S', 'X', 'T', 'C');
+    // Bump whenever the file layout or how keys are computed changes.
+    constexpr uint32_t TEXTURE_CACHE_VERSION = 1;
+
+    struct ArchiveFingerprint {
+        uint64_t size{ 0 };
+        int64_t mtime{ 0 };
+
+        bool operator==(const ArchiveFingerprint&) const = default;
+
+        static bool of(const std::filesystem::path& path, ArchiveFingerprint& out) {
+            std::error_code ec;
+            out.size = std::filesystem::file_size(path, ec);
+            if (ec) return false;
+            out.mtime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+            return !ec;
+        }
+    };
+
+    struct CachedArchive {
+        ArchiveFingerprint fingerprint;
+        std::span<const uint64_t> keys; // into the mapped file
+    };
+
+    // The cache file: a header, one entry per archive (its lowercase file name, fingerprint and
+    // key count), then, 8-byte aligned, the merged index followed by each archive's own keys in
+    // entry order. All keys are sorted and unique, so the merged index can be searched in place.
+    struct TextureCache {
+        std::unordered_map<std::string, CachedArchive> archives;
+        std::span<const uint64_t> merged;
+
+        // Maps and checks the file. A missing, damaged or outdated file, or one built with the
+        // other kind of key, leaves the cache empty.
+        bool load(const std::filesystem::path& path, bool fromRecords, MappedFile& file) {
+            if (!file.open(path)) {
+                logger::debug(std::format("no texture index cache at {}", path.string()));
+                return false;
+            }
+            std::span<const uint8_t> buf = file.bytes();
+            size_t off = 0;
+            auto get = [&](auto& v) {
+                if (buf.size() - off < sizeof(v)) return false;
+                std::memcpy(&v, buf.data() + off, sizeof(v));
+                off += sizeof(v);
+                return true;
+            };
+            uint32_t magic = 0, version = 0, recordKeys = 0, count = 0;
+            uint64_t mergedCount = 0;
+            if (!get(magic) || !get(version) || !get(recordKeys) || !get(count) || !get(mergedCount)
+                || magic != TEXTURE_CACHE_MAGIC || version != TEXTURE_CACHE_VERSION || recordKeys != (uint32_t)fromRecords) {
+                logger::info(std::format("texture index cache {} is from another version or setting; it will be rebuilt", path.string()));
+                return false;
+            }
+            std::vector<std::pair<std::string, CachedArchive>> entries(count);
+            std::vector<uint32_t> keyCounts(count);
+            for (uint32_t i = 0; i < count; i++) {
+                uint16_t nameLen = 0;
+                if (!get(nameLen) || buf.size() - off < nameLen) return damaged(path);
+                entries[i].first.assign(reinterpret_cast<const char*>(buf.data() + off), nameLen);
+                off += nameLen;
+                if (!get(entries[i].second.fingerprint.size) || !get(entries[i].second.fingerprint.mtime) || !get(keyCounts[i]))
+                    return damaged(path);
+            }
+            off = (off + 7) & ~size_t(7);
+            auto keysAt = [&](uint64_t n, std::span<const uint64_t>& out) {
+                if (off > buf.size() || (buf.size() - off) / sizeof(uint64_t) < n) return false;
+                out = { reinterpret_cast<const uint64_t*>(buf.data() + off), (size_t)n };
+                off += n * sizeof(uint64_t);
+                return true;
+            };
+            if (!keysAt(mergedCount, merged)) return damaged(path);
+            for (uint32_t i = 0; i < count; i++) {
+                if (!keysAt(keyCounts[i], entries[i].second.keys)) return damaged(path);
+                archives.insert(std::move(entries[i]));
+            }
+            return true;
+        }
+
+        bool damaged(const std::filesystem::path& path) {
+            logger::warn(std::format("texture index cache {} is damaged; it will be rebuilt", path.string()));
+            archives.clear();
+            merged = {};
+            return false;
+        }
+    };
+
+    // Writes the cache beside `path` and swaps it in. `old` is the mapping of the file being
+    // replaced, which `keys` may point into; it is closed just before the swap, since a mapped
+    // file can't be replaced on Windows.
+    bool save_texture_cache(const std::filesystem::path& path, bool fromRecords,
+        const std::vector<std::string>& names, const std::vector<ArchiveFingerprint>& fingerprints,
+        const std::vector<std::span<const uint64_t>>& keys, std::span<const uint64_t> merged, MappedFile& old)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+        std::filesystem::path tmp = path;
+        tmp += ".tmp";
+        {
+            std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+            auto put = [&f](const auto& v) { f.write(reinterpret_cast<const char*>(&v), sizeof(v)); };
+            auto putKeys = [&f](std::span<const uint64_t> k) { f.write(reinterpret_cast<const char*>(k.data()), k.size_bytes()); };
+            put(TEXTURE_CACHE_MAGIC);
+            put(TEXTURE_CACHE_VERSION);
+            put((uint32_t)fromRecords);
+            put((uint32_t)names.size());
+            put((uint64_t)merged.size());
+            size_t written = 24;
+            for (size_t i = 0; i < names.size(); i++) {
+                put((uint16_t)names[i].size());
+                f.write(names[i].data(), names[i].size());
+                put(fingerprints[i].size);
+                put(fingerprints[i].mtime);
+                put((uint32_t)keys[i].size());
+                written += 2 + names[i].size() + 20;
+            }
+            static const char zeros[8] = {};
+            f.write(zeros, ((written + 7) & ~size_t(7)) - written);
+            putKeys(merged);
+            for (std::span<const uint64_t> k : keys) putKeys(k);
+            if (!f) {
+                logger::warn(std::format("could not write texture index cache {}", tmp.string()));
+                return false;
+            }
+        }
+        old.close();
+        std::filesystem::rename(tmp, path, ec);
+        if (ec) {
+            logger::warn(std::format("could not replace texture index cache {}: {}", path.string(), ec.message()));
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+        return true;
+    }
+}
+
+void TextureIndex::build()
 {
-    if (index.size() == 0) {
-        // Index isn't built yet.
+    std::call_once(built, [this] {
         // We have no choice but to index every BA2 file, because
         // many mods depend on materials from the various vanilla and DLCs.
         // We can't easily step through RE::TESFiles because the vanilla files
@@ -61,12 +372,138 @@ bool TextureIndex::contains(const std::string& path)
         // Granted it's possible not every BA2 present will be actually used.
         // But indexing them all is probably the safest heuristic at this point.
         benchmark("building texture index", [&] {
-            for (auto ba2 : scandir(GetDataDir(), ".ba2", false)) {
-                logger::debug(std::format("scanning BA2 {}", ba2));
-                ReadBA2NameTable(ba2, index);
-            }
+            indexArchives();
+            indexLooseFiles();
         });
+    });
+}
+
+void TextureIndex::indexArchives()
+{
+    // Developer aid: set SCSCD_VERIFY_TEXTURE_INDEX to check the index against the archives'
+    // name tables: hash matches against the names themselves, or record hashes against them.
+    // Every archive is read, and the cache is neither used nor updated.
+    const char* verifyEnv = std::getenv("SCSCD_VERIFY_TEXTURE_INDEX");
+    const bool verify = verifyEnv && *verifyEnv;
+
+    const std::vector<std::string> ba2s = scandir(GetDataDir(), ".ba2", false);
+    std::vector<std::string> archiveNames(ba2s.size());
+    std::vector<ArchiveFingerprint> fingerprints(ba2s.size());
+    for (size_t i = 0; i < ba2s.size(); i++) {
+        archiveNames[i] = std::filesystem::path(ba2s[i]).filename().string();
+        std::transform(archiveNames[i].begin(), archiveNames[i].end(), archiveNames[i].begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        ArchiveFingerprint::of(ba2s[i], fingerprints[i]);
+    }
+    // In name order, so the folder listing's order doesn't matter.
+    std::vector<size_t> byName(ba2s.size());
+    for (size_t i = 0; i < byName.size(); i++) byName[i] = i;
+    std::sort(byName.begin(), byName.end(), [&](size_t a, size_t b) { return archiveNames[a] < archiveNames[b]; });
+    fingerprint_ = fnv1a_fold(1469598103934665603ull, &fromRecords, sizeof(fromRecords));
+    for (size_t i : byName) {
+        fingerprint_ = fnv1a_fold(fingerprint_, archiveNames[i].c_str(), archiveNames[i].size() + 1);
+        fingerprint_ = fnv1a_fold(fingerprint_, &fingerprints[i].size, sizeof(fingerprints[i].size));
+        fingerprint_ = fnv1a_fold(fingerprint_, &fingerprints[i].mtime, sizeof(fingerprints[i].mtime));
     }
 
-    return index.contains(NormalizeLowerSlash(path));
+    const std::filesystem::path cachePath = DataPath(TEXTURE_CACHE_FILE);
+    TextureCache cached;
+    if (!verify) cached.load(cachePath, fromRecords, cache);
+    std::vector<std::span<const uint64_t>> archiveKeys(ba2s.size());
+    std::vector<std::string> stale;
+    std::vector<size_t> staleAt;
+    for (size_t i = 0; i < ba2s.size(); i++) {
+        auto it = cached.archives.find(archiveNames[i]);
+        if (it != cached.archives.end() && it->second.fingerprint == fingerprints[i]) {
+            archiveKeys[i] = it->second.keys;
+        }
+        else {
+            stale.push_back(ba2s[i]);
+            staleAt.push_back(i);
+        }
+    }
+    if (!verify && stale.empty() && cached.archives.size() == ba2s.size()) {
+        keys = cached.merged;
+        logger::info(std::format("texture index: {} paths mapped from cache, all {} archives unchanged", keys.size(), ba2s.size()));
+        return;
+    }
+
+    std::vector<BA2Shard> shards;
+    ReadBA2Entries(stale, fromRecords, verify, shards);
+    BA2Shard found;
+    for (size_t s = 0; s < shards.size(); s++) {
+        archiveKeys[staleAt[s]] = shards[s].keys;
+        std::move(shards[s].named.begin(), shards[s].named.end(), std::back_inserter(found.named));
+        found.stringSetBytes += shards[s].stringSetBytes;
+        found.mismatches += shards[s].mismatches;
+    }
+    if (verify && fromRecords) {
+        logger::info(std::format("texture index: {} record hashes disagree with the archives' name tables", found.mismatches));
+    }
+    if (!found.named.empty()) {
+        std::sort(found.named.begin(), found.named.end());
+        found.named.erase(std::unique(found.named.begin(), found.named.end()), found.named.end());
+        for (size_t i = 0; i < found.named.size(); i++) {
+            if (i > 0 && found.named[i].first == found.named[i - 1].first)
+                logger::warn(std::format("texture paths {} and {} share a hash", found.named[i - 1].second, found.named[i].second));
+            hashes.push_back(found.named[i].first);
+            nameAt.push_back((uint32_t)names.size());
+            names += found.named[i].second;
+            names += '\0';
+        }
+    }
+    else {
+        hashes = MergeRuns(archiveKeys);
+    }
+    keys = hashes;
+
+    if (!verify) {
+        logger::info(std::format("texture index cache: {} archives unchanged, {} read, {} no longer there or changed",
+            ba2s.size() - stale.size(), stale.size(), cached.archives.size() - (ba2s.size() - stale.size())));
+        save_texture_cache(cachePath, fromRecords, archiveNames, fingerprints, archiveKeys, keys, cache);
+    }
+    if (found.stringSetBytes > 0 && !fromRecords) {
+        logger::info(std::format("texture index: {} paths, {} KB (unordered_set<std::string> would be ~{} KB)",
+            keys.size(), memoryBytes() / 1024, found.stringSetBytes / 1024));
+    }
+    else {
+        logger::info(std::format("texture index: {} paths, {} KB", keys.size(), memoryBytes() / 1024));
+    }
+}
+
+void TextureIndex::indexLooseFiles()
+{
+    // Loose files override archived ones, and only these two folders hold what validation asks
+    // about. One walk, and the same keys as the archive index, so a check is a probe either way.
+    const std::filesystem::path data = GetDataDir();
+    for (const char* folder : { "Materials", "Textures" }) {
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(data / folder, std::filesystem::directory_options::skip_permission_denied, ec);
+                !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (!it->is_regular_file(ec)) continue;
+            const std::string relative = it->path().lexically_relative(data).generic_string();
+            loose.push_back(fromRecords ? recordKey(relative) : hash(relative));
+        }
+    }
+    std::sort(loose.begin(), loose.end());
+    loose.erase(std::unique(loose.begin(), loose.end()), loose.end());
+    loose.shrink_to_fit();
+    fingerprint_ = fnv1a_fold(fingerprint_, loose.data(), loose.size() * sizeof(uint64_t));
+    logger::info(std::format("loose file index: {} files under Materials and Textures, {} KB", loose.size(), loose.capacity() * sizeof(uint64_t) / 1024));
+}
+
+bool TextureIndex::contains(std::string_view path)
+{
+    // Usually already built by the pre-scan; if that is still running, this waits for it.
+    build();
+    const uint64_t h = fromRecords ? recordKey(path) : hash(path);
+    if (std::binary_search(loose.begin(), loose.end(), h)) return true;
+    auto [lo, hi] = std::equal_range(keys.begin(), keys.end(), h);
+    if (names.empty()) return lo != hi;
+    for (auto it = lo; it != hi; ++it) {
+        std::string_view name(names.data() + nameAt[it - keys.begin()]);
+        if (name.size() == path.size() && std::equal(name.begin(), name.end(), path.begin(),
+                [](char a, char b) { return a == NormalizeChar(b); }))
+            return true;
+    }
+    return false;
 }
@@ -1,17 +1,75 @@
 #pragma once
 
 #include "scscd.h"
+#include "mapped_file.h"
+#include <mutex>
+#include <span>
+#include <string_view>
 
-// Maintains an index of texture paths by BA2 archive file. The first time contains() is called,
-// the TESFile filename is used to construct a '[plugin] - Textures.ba2' filename, and that BA2
-// is scanned. All filenames within it are indexed.
+// Where the texture index cache lives, relative to the Data folder.
+inline constexpr const char* TEXTURE_CACHE_FILE = "F4SE\\Plugins\\scscd\\cache\\texture_index.bin";
+
+// Maintains an index of the file paths in every BA2 archive in the Data folder, plus the loose
+// files under Data/Materials and Data/Textures, so that material validation can tell whether a
+// material or texture exists without opening it.
 //
 // This is needed because the engine-provided BSResourceNiBinaryStream does not scan texture archives,
 // only general ones. Until some engine-provided substitute can be discovered, we have to index them
-// ourselves if we want to know if a texture exists or not.
+// ourselves if we want to know if a texture exists or not. And with everything indexed, there's no
+// need to open a stream per candidate path just to see whether it opens.
+//
+// Paths are kept only as a sorted array of 64-bit keys, 8 bytes a path instead of a string and a
+// hash node each. By default the keys are built from the hashes every archive already stores in
+// its file records (directory, file name and extension), so only the record table right after the
+// header is read and the name table at the end never is. Otherwise the names are read and each
+// normalized path (lowercase, forward slashes) is hashed. Either way, two different paths in the
+// whole Data folder sharing a key is vanishingly unlikely; set SCSCD_VERIFY_TEXTURE_INDEX to
+// read the names as well and check the keys against them.
+//
+// The keys are saved to TEXTURE_CACHE_FILE along with each archive's own keys and its size and
+// modification time. On the next start only archives that were added or changed are read again,
+// and if none were, the saved index is memory-mapped and used in place. Loose files are walked
+// again every start.
 class TextureIndex {
-	std::unordered_set<std::string> index;
+	std::span<const uint64_t> keys; // sorted; a key appears more than once only if names collide
+	std::vector<uint64_t> hashes;   // backs keys, unless they are mapped straight from the cache
+	MappedFile cache;
+	std::vector<uint64_t> loose;    // sorted keys of loose files, same kind as keys
+	std::vector<uint32_t> nameAt; // with verification: offset of each entry's name in names
+	std::string names;            // with verification: the normalized names, NUL-separated
+	std::once_flag built;
+	bool fromRecords{ true };
+	uint64_t fingerprint_{ 0 };   // over the archives' names and fingerprints and the loose keys
+
+	void indexArchives();
+	void indexLooseFiles();
 
 public:
-	bool contains(const std::string& path);
+	// Hash of a path as stored in the index: FNV-1a over its bytes, lowercased, with '\' read as
+	// '/'. Doesn't allocate.
+	static uint64_t hash(std::string_view path);
+
+	// Key of a path as built from an archive's file records: its directory and file stem hashed
+	// the way the archive hashes them, and up to 4 characters of extension. Doesn't allocate.
+	static uint64_t recordKey(std::string_view path);
+	static uint64_t recordKey(uint32_t dirHash, uint32_t fileHash, uint32_t ext);
+
+	// Whether to key the index on the archives' record hashes (the default) or on hashes of their
+	// name tables. Call before build().
+	void useRecordHashes(bool records) { fromRecords = records; }
+
+	// Indexes every BA2 in the Data folder and the loose files, once. contains() calls this itself, but it may also be
+	// called ahead of time from another thread; any caller that arrives while it runs waits for it.
+	void build();
+
+	// True if a loose file or an archived file has this path, relative to Data.
+	bool contains(std::string_view path);
+
+	// Changes whenever anything the index was built from might have: an archive added, removed
+	// or rewritten, or a loose file added or removed. Lets a verdict worked out from the index
+	// be kept for as long as the index is the same. Builds the index if need be.
+	uint64_t fingerprint() { build(); return fingerprint_; }
+
+	size_t size() const { return keys.size(); }
+	size_t memoryBytes() const { return hashes.capacity() * sizeof(uint64_t) + nameAt.capacity() * sizeof(uint32_t) + names.capacity() + loose.capacity() * sizeof(uint64_t); }
 };
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Number of workers to use for startup jobs. One per hardware thread; the game is sitting on
+// a loading screen while these run, so there's nothing else to leave room for.
+inline size_t worker_count() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs fn(i) for every i in [0, count) on up to `workers` threads, the calling thread included,
+// and returns once all of them are done. Items are handed out one at a time from a shared
+// counter rather than pre-split into ranges, so one very large item (Fallout4.esm) doesn't leave
+// the remaining workers idle behind it.
+//
+// fn must not throw, and must only touch state that is private to item i or otherwise safe
+// to share.
+inline void parallel_for(size_t count, const std::function<void(size_t)>& fn, size_t workers = worker_count())
+{
+    const size_t threads = std::min(std::max<size_t>(workers, 1), count);
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next{ 0 };
+    auto work = [&] {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+            fn(i);
+    };
+
+    std::vector<std::jthread> pool;
+    pool.reserve(threads - 1);
+    for (size_t t = 1; t < threads; t++)
+        pool.emplace_back(work);
+    work();
+    // jthread joins on destruction
+}
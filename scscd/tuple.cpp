@@ -111,20 +111,26 @@ Tuple::Tuple(uint8_t minLevel, bool nsfw, uint32_t sexes, uint32_t occupations,
  * exclusively. For example if armor A specifies Human and Ghoul
  * but armor B specifies only Ghoul, the result will be [Ghoul].
  */
-std::vector<RE::TESRace*> Tuple::possibleRaces() {
-	std::vector<RE::TESRace*> races;
+std::vector<uint32_t> Tuple::possibleRaces() {
+	std::vector<uint32_t> races;
 	logger::trace(std::format("> Tuple[{}]::possibleRaces() num armors = {}", id, armors.size()));
 	for (uint32_t formID : armors) {
+		// Plugin records first; the engine only for armors the catalog doesn't have.
+		if (auto catalogued = ArmorIndex::catalog().armorRaces(formID)) {
+			races.insert(races.end(), catalogued->begin(), catalogued->end());
+			continue;
+		}
 		RE::TESForm* form = RE::TESForm::GetFormByID(formID);
 		if (!form) {
 			logger::warn(std::format("! Tuple[{}]::possibleRaces() form {:#010x} not found (this shouldn't happen!)", id, formID));
 			continue;
 		}
 		RE::TESObjectARMO* armor = form->As<RE::TESObjectARMO>();
-		auto armorRaces = armorSupportedRaces(armor);
-		races.insert(races.end(), armorRaces.begin(), armorRaces.end());
+		for (RE::TESRace* race : armorSupportedRaces(armor))
+			races.push_back(race->GetFormID());
 	}
-	raceVectorDedup(races);
+	std::sort(races.begin(), races.end());
+	races.erase(std::unique(races.begin(), races.end()), races.end());
 	logger::trace(std::format("< Tuple[{}]::possibleRaces() => {} races", id, races.size()));
 	return races;
 }
@@ -137,6 +143,10 @@ uint32_t Tuple::sexes() {
 	if (this->overrideSexes) return this->overrideSexes;
 	int sexes = ALL_SEXES;
 	for (uint32_t formID : armors) {
+		if (auto catalogued = ArmorIndex::catalog().armorSexes(formID)) {
+			sexes = sexes & *catalogued;
+			continue;
+		}
 		RE::TESForm* form = RE::TESForm::GetFormByID(formID);
 		if (form) logger::trace(": Tuple::sexes() armor form found");
 		else {
@@ -180,9 +190,9 @@ std::vector<uint32_t> Tuple::possibleOccupations() {
 
 std::string Tuple::inspect() {
 	std::string r = std::format("<Tuple id={} races=[", id);
-	std::vector<RE::TESRace*> races = this->possibleRaces();
+	std::vector<uint32_t> races = this->possibleRaces();
 	for (int i = 0; i < races.size(); i++) {
-		r += std::format("{:#010x}", races[i]->GetFormID());
+		r += std::format("{:#010x}", races[i]);
 		if (i > 0) r += ", ";
 	}
 	r += std::format("] minLevel={} sexes={:#x} occup={:#010x} nsfw={} slots={:#010x}>", minLevel, sexes(), (uint32_t) occupations, isNSFW ? 1 : 0, slots);
@@ -177,7 +177,7 @@ public:
 	 * exclusively. For example if armor A specifies Human and Ghoul
 	 * but armor B specifies only Ghoul, the result will be [Ghoul].
 	 */
-	std::vector<RE::TESRace*> possibleRaces();
+	std::vector<uint32_t> possibleRaces();
 
 	/*
 	 * Returns the bitmap of possible sexes for this Tuple.